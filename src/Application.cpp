@@ -7,13 +7,19 @@
 #include <glad/gl.h>
 
 #include "Application.h"
+#include "Tracer.h"
 #include <GLFW/glfw3.h>
 #include <algorithm>
+#include <cfloat>
 #include <cstdio>
+#include <cstring>
+#include <ctime>
 #include <imgui/backends/imgui_impl_glfw.h>
 #include <imgui/backends/imgui_impl_opengl3.h>
 #include <imgui/imgui.h>
+#include <imgui/imgui_internal.h>
 #include <stdexcept>
+#include <thread>
 
 namespace Carousel
 {
@@ -59,11 +65,16 @@ Application::Application()
     create_finder();
 
     glfwMakeContextCurrent(m_window);
-    glfwSwapInterval(s_use_vsync);
+
+    m_is_adaptive_vsync_supported =
+        glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear");
 
     if (!gladLoadGL(glfwGetProcAddress))
         throw std::runtime_error("Failed to load GLAD");
 
+    m_multiviewer_gpu_timer.emplace();
+    m_render_gpu_timer.emplace();
+
     auto audio_context_config = ma_context_config_init();
     // Just so we know if this was successfully initialized or not.
     audio_context_config.pUserData = this;
@@ -84,6 +95,18 @@ Application::Application()
     if (!initialize_playback_device(nullptr))
         fprintf(stderr, "Failed to initialize default playback device, there will be no audio!\n");
 
+    // These only note that something happened, to wake a render-on-demand loop. They are installed before ImGui's, which
+    // will then chain to them.
+    glfwSetWindowUserPointer(m_window, this);
+    glfwSetCursorPosCallback(m_window, [](GLFWwindow* window, double, double) { glfw_event_callback(window); });
+    glfwSetMouseButtonCallback(m_window, [](GLFWwindow* window, int, int, int) { glfw_event_callback(window); });
+    glfwSetScrollCallback(m_window, [](GLFWwindow* window, double, double) { glfw_event_callback(window); });
+    glfwSetKeyCallback(m_window, [](GLFWwindow* window, int, int, int, int) { glfw_event_callback(window); });
+    glfwSetCharCallback(m_window, [](GLFWwindow* window, unsigned int) { glfw_event_callback(window); });
+    glfwSetWindowFocusCallback(m_window, [](GLFWwindow* window, int) { glfw_event_callback(window); });
+    glfwSetCursorEnterCallback(m_window, [](GLFWwindow* window, int) { glfw_event_callback(window); });
+    glfwSetWindowRefreshCallback(m_window, [](GLFWwindow* window) { glfw_event_callback(window); });
+
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGui::StyleColorsDark();
@@ -94,16 +117,65 @@ Application::Application()
     auto& io = ImGui::GetIO();
     io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
 
-    glfwSetFramebufferSizeCallback(m_window,
-                                   [](GLFWwindow* window, int width, int height) { glViewport(0, 0, width, height); });
+    // The set of open source windows is persisted alongside the window layout in imgui.ini.
+    ImGuiSettingsHandler settings_handler;
+    settings_handler.TypeName = "Carousel";
+    settings_handler.TypeHash = ImHashStr(settings_handler.TypeName);
+    settings_handler.ReadOpenFn = settings_read_open;
+    settings_handler.ReadLineFn = settings_read_line;
+    settings_handler.WriteAllFn = settings_write_all;
+    settings_handler.UserData = this;
+    ImGui::AddSettingsHandler(&settings_handler);
+
+    // ImGui would otherwise load this lazily on the first frame, but we want to start connecting to our sources now.
+    if (io.IniFilename)
+        ImGui::LoadIniSettingsFromDisk(io.IniFilename);
+
+    apply_present_mode();
+
+    glfwSetFramebufferSizeCallback(m_window, [](GLFWwindow* window, int width, int height) {
+        glViewport(0, 0, width, height);
+        glfw_event_callback(window);
+    });
 
     glClearColor(0.25f, 0.25f, 0.25f, 1.0f);
 
     free_if_error_occurs.disarm();
+
+    restore_session();
+
+    m_receiver_statistics_thread =
+        std::jthread([this](std::stop_token stop_token) { sample_receiver_statistics(stop_token); });
 }
 
 Application::~Application()
 {
+    // This reaches into the source windows, so it has to stop before they go away.
+    m_receiver_statistics_thread.request_stop();
+    if (m_receiver_statistics_thread.joinable())
+        m_receiver_statistics_thread.join();
+
+    // Stop the audio callback first, so we are free to destroy the source windows below.
+    if (m_playback_device.pUserData)
+    {
+        ma_device_uninit(&m_playback_device);
+        m_playback_device.pUserData = nullptr;
+    }
+
+    // This will save imgui.ini one last time, which includes our open source windows, so do it before they are gone.
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
+
+    // Anything holding GL objects has to go whilst we still have a context.
+    m_ndi_source_windows.clear();
+    m_source_browser.reset();
+    m_multiviewer_output.reset();
+    m_multiviewer.reset();
+    m_fullscreen_output.reset();
+    m_multiviewer_gpu_timer.reset();
+    m_render_gpu_timer.reset();
+
     glfwDestroyWindow(m_window);
 
     if (m_ndi_finder_instance)
@@ -112,12 +184,6 @@ Application::~Application()
         m_ndi_finder_instance = nullptr;
     }
 
-    if (m_playback_device.pUserData)
-    {
-        ma_device_uninit(&m_playback_device);
-        m_playback_device.pUserData = nullptr;
-    }
-
     if (m_audio_context.pUserData)
     {
         ma_context_uninit(&m_audio_context);
@@ -127,21 +193,54 @@ Application::~Application()
 
 int Application::run()
 {
+    Tracer::set_thread_name("Main");
+
     while (!glfwWindowShouldClose(m_window))
     {
-        uint32_t number_of_found_sources{};
-        m_found_ndi_sources = {NDIlib_find_get_current_sources(m_ndi_finder_instance, &number_of_found_sources),
-                               static_cast<size_t>(number_of_found_sources)};
+        if (!m_fullscreen_output_source_name.empty())
+        {
+            render_fullscreen_output();
+            continue;
+        }
+
+        if (m_render_on_demand)
+            wait_for_events();
+        else
+            glfwPollEvents();
+
+        auto has_source_window_changed = poll_source_windows();
+
+        // The output has its own frame rate to keep, whether or not anything on the display has changed.
+        auto now = std::chrono::steady_clock::now();
+        auto is_multiviewer_output_frame_due = m_multiviewer_output && now >= m_multiviewer_output->next_frame_time();
+
+        if (m_render_on_demand && !has_source_window_changed && m_frames_to_render == 0 &&
+            !is_multiviewer_output_frame_due && now - m_last_render_time < s_minimum_refresh_interval)
+            continue;
+
+        if (m_frames_to_render > 0)
+            m_frames_to_render--;
 
-        glfwPollEvents();
+        m_last_render_time = std::chrono::steady_clock::now();
+
+        {
+            TraceScope trace_scope("Discovery");
+            uint32_t number_of_found_sources{};
+            m_found_ndi_sources = {NDIlib_find_get_current_sources(m_ndi_finder_instance, &number_of_found_sources),
+                                   static_cast<size_t>(number_of_found_sources)};
+        }
 
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
-        ImGui::DockSpaceOverViewport();
+        // The dockspace would draw over the multiviewer, and none of the source windows are shown whilst it's enabled.
+        if (!m_is_multiviewer_enabled)
+            ImGui::DockSpaceOverViewport();
 
+#ifndef NDEBUG
         ImGui::ShowDemoWindow();
+#endif
 
         if (ImGui::BeginMainMenuBar())
         {
@@ -171,18 +270,7 @@ int Application::run()
                                 [&source](const auto& source_window) { return source_window->source() == source; });
 
                             if (ImGui::MenuItem(source.p_ndi_name, nullptr, false, does_source_have_existing_window))
-                            {
-                                printf("Connecting to source %d (%s)\n", i, source.p_ndi_name);
-
-                                try
-                                {
-                                    m_ndi_source_windows.push_back(std::make_unique<NDISourceWindow>(source));
-                                }
-                                catch (const std::exception& ex)
-                                {
-                                    fprintf(stderr, "Failed to create NDI source window: %s\n", ex.what());
-                                }
-                            }
+                                open_source_window(source);
 
                             ImGui::PopID();
                         }
@@ -191,12 +279,213 @@ int Application::run()
                     ImGui::EndMenu();
                 }
 
+                if (ImGui::MenuItem("Source Browser", nullptr, &m_is_source_browser_open))
+                    ImGui::MarkIniSettingsDirty();
+
+                if (ImGui::BeginMenu("Routes"))
+                {
+                    draw_routes_menu();
+                    ImGui::EndMenu();
+                }
+
+                if (ImGui::BeginMenu("Tally"))
+                {
+                    if (ImGui::MenuItem("Send Tally", nullptr, &m_is_tally_enabled))
+                        ImGui::MarkIniSettingsDirty();
+
+                    ImGui::Separator();
+
+                    if (ImGui::BeginTable("Tally Mapping", 3))
+                    {
+                        ImGui::TableSetupColumn("When a source is");
+                        ImGui::TableSetupColumn("Program");
+                        ImGui::TableSetupColumn("Preview");
+                        ImGui::TableHeadersRow();
+
+                        auto tally_mapping_row = [this](const char* label, ViewState view_state) {
+                            auto& tally = m_tally_mapping[static_cast<int>(view_state)];
+
+                            ImGui::PushID(label);
+                            ImGui::TableNextRow();
+                            ImGui::TableNextColumn();
+                            ImGui::TextUnformatted(label);
+                            ImGui::TableNextColumn();
+                            if (ImGui::CheckboxFlags("##Program", &tally, s_tally_program))
+                                ImGui::MarkIniSettingsDirty();
+                            ImGui::TableNextColumn();
+                            if (ImGui::CheckboxFlags("##Preview", &tally, s_tally_preview))
+                                ImGui::MarkIniSettingsDirty();
+                            ImGui::PopID();
+                        };
+
+                        tally_mapping_row("Hidden", ViewState::Hidden);
+                        tally_mapping_row("Visible", ViewState::Visible);
+                        tally_mapping_row("Focused", ViewState::Focused);
+                        tally_mapping_row("Fullscreen", ViewState::Fullscreen);
+
+                        ImGui::EndTable();
+                    }
+
+                    ImGui::EndMenu();
+                }
+
+                if (ImGui::BeginMenu("Recording"))
+                {
+                    // Only we add or remove windows, and recording doesn't touch anything the audio callback uses, so
+                    // there's no need to hold it up (for as long as it takes to create a recording's files) by taking
+                    // the mixer lock.
+                    if (m_ndi_source_windows.empty())
+                        ImGui::TextDisabled("Open a source first");
+
+                    for (auto& ndi_source_window : m_ndi_source_windows)
+                    {
+                        auto source_name = std::string(ndi_source_window->source().name());
+
+                        if (ImGui::MenuItem(source_name.c_str(), nullptr, ndi_source_window->is_recording()))
+                        {
+                            if (ndi_source_window->is_recording())
+                                ndi_source_window->stop_recording();
+                            else
+                                ndi_source_window->start_recording(m_recording_directory);
+                        }
+
+                        if (auto* recorder = ndi_source_window->recorder())
+                        {
+                            ImGui::Indent();
+                            ImGui::TextDisabled("%llu frames, %.1f MB written, %llu dropped%s",
+                                                static_cast<unsigned long long>(
+                                                    recorder->number_of_recorded_video_frames()),
+                                                static_cast<double>(recorder->number_of_bytes_written()) / 1e6,
+                                                static_cast<unsigned long long>(
+                                                    recorder->number_of_dropped_video_frames()),
+                                                recorder->has_failed() ? ", write failed" : "");
+                            ImGui::Unindent();
+                        }
+                        else if (!ndi_source_window->recording_error().empty())
+                        {
+                            ImGui::Indent();
+                            ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "%s",
+                                               ndi_source_window->recording_error().c_str());
+                            ImGui::Unindent();
+                        }
+                    }
+
+                    ImGui::Separator();
+                    ImGui::TextDisabled("Recording to %s",
+                                        m_recording_directory.empty() ? "the working directory"
+                                                                      : m_recording_directory.c_str());
+
+                    ImGui::EndMenu();
+                }
+
                 if (ImGui::MenuItem("Restart Finder"))
                     create_finder();
 
                 ImGui::EndMenu();
             }
 
+            if (ImGui::BeginMenu("View"))
+            {
+                if (ImGui::MenuItem("Render On Demand", nullptr, &m_render_on_demand))
+                    ImGui::MarkIniSettingsDirty();
+
+                if (ImGui::MenuItem("Statistics", nullptr, &m_is_statistics_window_open))
+                    ImGui::MarkIniSettingsDirty();
+
+                if (ImGui::MenuItem("Multiviewer", nullptr, &m_is_multiviewer_enabled))
+                    ImGui::MarkIniSettingsDirty();
+
+                if (ImGui::BeginMenu("Multiviewer Layout"))
+                {
+                    if (ImGui::SliderInt("Columns", &m_multiviewer_columns, 0, 16,
+                                         m_multiviewer_columns == 0 ? "Auto" : "%d", ImGuiSliderFlags_AlwaysClamp))
+                        ImGui::MarkIniSettingsDirty();
+
+                    for (auto tile_texture_height : {360, 540, 720, 1080})
+                    {
+                        auto label = std::to_string(tile_texture_height) + "p Tiles";
+                        if (ImGui::MenuItem(label.c_str(), nullptr,
+                                            m_multiviewer_tile_texture_height == tile_texture_height))
+                        {
+                            m_multiviewer_tile_texture_height = tile_texture_height;
+                            ImGui::MarkIniSettingsDirty();
+                        }
+                    }
+
+                    ImGui::EndMenu();
+                }
+
+                if (ImGui::BeginMenu("Multiviewer Output"))
+                {
+                    draw_multiviewer_output_menu();
+                    ImGui::EndMenu();
+                }
+
+                if (ImGui::BeginMenu("Fullscreen Output"))
+                {
+                    std::lock_guard ndi_source_windows_lock(m_ndi_source_windows_mutex);
+
+                    if (m_ndi_source_windows.empty())
+                        ImGui::TextDisabled("Open a source first");
+
+                    int number_of_monitors{};
+                    auto monitors = glfwGetMonitors(&number_of_monitors);
+
+                    for (auto& ndi_source_window : m_ndi_source_windows)
+                    {
+                        auto source_name = std::string(ndi_source_window->source().name());
+
+                        if (ImGui::BeginMenu(source_name.c_str()))
+                        {
+                            for (auto i = 0; i < number_of_monitors; i++)
+                            {
+                                ImGui::PushID(i);
+                                if (ImGui::MenuItem(glfwGetMonitorName(monitors[i])))
+                                    enter_fullscreen_output(source_name, monitors[i]);
+                                ImGui::PopID();
+                            }
+
+                            ImGui::EndMenu();
+                        }
+                    }
+
+                    ImGui::EndMenu();
+                }
+
+                if (ImGui::BeginMenu("Present Mode"))
+                {
+                    auto present_mode_menu_item = [this](const char* label, PresentMode present_mode,
+                                                         bool enabled = true) {
+                        if (ImGui::MenuItem(label, nullptr, m_present_mode == present_mode, enabled))
+                        {
+                            m_present_mode = present_mode;
+                            apply_present_mode();
+                            ImGui::MarkIniSettingsDirty();
+                        }
+                    };
+
+                    present_mode_menu_item("VSync", PresentMode::VSync);
+                    present_mode_menu_item("Adaptive VSync", PresentMode::AdaptiveVSync,
+                                           m_is_adaptive_vsync_supported);
+                    present_mode_menu_item("Uncapped", PresentMode::Uncapped);
+                    present_mode_menu_item("Frame Rate Limited", PresentMode::FrameRateLimited);
+
+                    if (ImGui::SliderInt("Limit", &m_frame_rate_limit, 10, 500, "%d FPS",
+                                         ImGuiSliderFlags_AlwaysClamp))
+                        ImGui::MarkIniSettingsDirty();
+
+                    ImGui::EndMenu();
+                }
+
+                if (ImGui::BeginMenu("Tracing"))
+                {
+                    draw_tracing_menu();
+                    ImGui::EndMenu();
+                }
+
+                ImGui::EndMenu();
+            }
+
             if (ImGui::BeginMenu("Audio"))
             {
                 ImGui::MenuItem("Focused Window Only", nullptr, &m_only_play_audio_from_focused_window);
@@ -230,6 +519,15 @@ int Application::run()
             ImGui::EndMainMenuBar();
         }
 
+        std::vector<std::unique_ptr<NDISourceWindow>> closed_source_windows;
+
+        if (m_is_multiviewer_enabled)
+        {
+            m_multiviewer_gpu_timer->begin();
+            update_multiviewer();
+            m_multiviewer_gpu_timer->end();
+        }
+        else
         {
             std::lock_guard ndi_source_windows_lock(m_ndi_source_windows_mutex);
 
@@ -249,23 +547,618 @@ int Application::run()
                 }
 
                 if (should_remove_source_window)
+                {
+                    closed_source_windows.push_back(std::move(*ndi_connection_iterator));
                     ndi_connection_iterator = m_ndi_source_windows.erase(ndi_connection_iterator);
+                    ImGui::MarkIniSettingsDirty();
+                }
                 else
                     ndi_connection_iterator++;
             }
         }
 
-        ImGui::Render();
+        // The audio callback can only reach a source window through m_ndi_source_windows, so now that we've released the
+        // lock, it can't be using these anymore. Their receivers are handed off to be destroyed on another thread.
+        closed_source_windows.clear();
 
-        glClear(GL_COLOR_BUFFER_BIT);
+        update_automatic_bandwidth();
+        update_tally();
+
+        if (m_is_statistics_window_open)
+            draw_statistics_window();
+
+        if (m_is_source_browser_open)
+            draw_source_browser();
+        else
+            m_source_browser.reset();
+
+        {
+            TraceScope trace_scope("Render");
+            ImGui::Render();
+
+            m_render_gpu_timer->begin();
+            glClear(GL_COLOR_BUFFER_BIT);
+
+            if (m_is_multiviewer_enabled && m_multiviewer)
+                m_multiviewer->render(ImGui::GetIO().DisplaySize);
+
+            update_multiviewer_output();
+
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            m_render_gpu_timer->end();
+        }
+
+        auto frame_work_milliseconds =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_last_render_time).count();
+        m_average_frame_work_milliseconds += (frame_work_milliseconds - m_average_frame_work_milliseconds) * 0.1;
 
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-        glfwSwapBuffers(m_window);
+        if (m_present_mode == PresentMode::FrameRateLimited)
+            limit_frame_rate();
+
+        present();
     }
 
     return 0;
 }
 
+void Application::wait_for_events()
+{
+    TraceScope trace_scope("Wait for events");
+    // Sleep until the soonest a source could have a new frame for us, unless some input wakes us up first.
+    std::chrono::nanoseconds timeout = s_minimum_refresh_interval;
+
+    {
+        std::lock_guard ndi_source_windows_lock(m_ndi_source_windows_mutex);
+        for (auto& ndi_source_window : m_ndi_source_windows)
+            timeout = std::min(timeout, ndi_source_window->poll_interval());
+    }
+
+    if (m_multiviewer_output)
+    {
+        auto until_next_frame = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            m_multiviewer_output->next_frame_time() - std::chrono::steady_clock::now());
+        timeout = std::clamp(until_next_frame, std::chrono::nanoseconds::zero(), timeout);
+    }
+
+    glfwWaitEventsTimeout(std::chrono::duration<double>(timeout).count());
+}
+
+void Application::apply_present_mode()
+{
+    // We may have read a mode from imgui.ini that this machine (or driver) doesn't support.
+    if (m_present_mode == PresentMode::AdaptiveVSync && !m_is_adaptive_vsync_supported)
+        m_present_mode = PresentMode::VSync;
+
+    switch (m_present_mode)
+    {
+        case PresentMode::VSync:
+            glfwSwapInterval(1);
+            break;
+        case PresentMode::AdaptiveVSync:
+            glfwSwapInterval(-1);
+            break;
+        case PresentMode::Uncapped:
+        case PresentMode::FrameRateLimited:
+            glfwSwapInterval(0);
+            break;
+    }
+
+    m_next_frame_deadline = {};
+}
+
+void Application::limit_frame_rate()
+{
+    TraceScope trace_scope("Limit frame rate");
+    auto frame_duration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / m_frame_rate_limit));
+    auto now = std::chrono::steady_clock::now();
+
+    // If we've fallen more than a frame behind (or just started), don't try to catch up by rushing frames out.
+    if (now - m_next_frame_deadline > frame_duration)
+        m_next_frame_deadline = now;
+
+    if (m_next_frame_deadline - now > s_frame_rate_limiter_spin_duration)
+        std::this_thread::sleep_until(m_next_frame_deadline - s_frame_rate_limiter_spin_duration);
+
+    while (std::chrono::steady_clock::now() < m_next_frame_deadline)
+        std::this_thread::yield();
+
+    m_next_frame_deadline += frame_duration;
+}
+
+void Application::enter_fullscreen_output(std::string_view source_name, GLFWmonitor* monitor)
+{
+    if (!m_fullscreen_output)
+    {
+        try
+        {
+            m_fullscreen_output = std::make_unique<FullscreenOutput>();
+        }
+        catch (const std::exception& ex)
+        {
+            fprintf(stderr, "Failed to create fullscreen output: %s\n", ex.what());
+            return;
+        }
+    }
+
+    glfwGetWindowPos(m_window, &m_windowed_x, &m_windowed_y);
+    glfwGetWindowSize(m_window, &m_windowed_width, &m_windowed_height);
+
+    auto video_mode = glfwGetVideoMode(monitor);
+    glfwSetWindowMonitor(m_window, monitor, 0, 0, video_mode->width, video_mode->height, video_mode->refreshRate);
+
+    m_fullscreen_output_source_name = source_name;
+}
+
+void Application::exit_fullscreen_output()
+{
+    glfwSetWindowMonitor(m_window, nullptr, m_windowed_x, m_windowed_y, m_windowed_width, m_windowed_height,
+                         GLFW_DONT_CARE);
+    m_fullscreen_output_source_name.clear();
+    m_frames_to_render = s_frames_to_render_after_event;
+}
+
+void Application::render_fullscreen_output()
+{
+    TraceScope trace_scope("Fullscreen output frame");
+    // Latency matters more than power here, so we don't wait for events even when rendering on demand.
+    glfwPollEvents();
+
+    if (glfwGetKey(m_window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+    {
+        exit_fullscreen_output();
+        return;
+    }
+
+    // Do any waiting before we take a frame, not after, so the frame is as new as possible when it's presented.
+    if (m_present_mode == PresentMode::FrameRateLimited)
+        limit_frame_rate();
+
+    int framebuffer_width{}, framebuffer_height{};
+    glfwGetFramebufferSize(m_window, &framebuffer_width, &framebuffer_height);
+
+    {
+        std::lock_guard ndi_source_windows_lock(m_ndi_source_windows_mutex);
+
+        auto ndi_source_window_iterator =
+            std::find_if(m_ndi_source_windows.begin(), m_ndi_source_windows.end(), [this](const auto& window) {
+                return window->source().name() == m_fullscreen_output_source_name;
+            });
+
+        if (ndi_source_window_iterator == m_ndi_source_windows.end())
+        {
+            exit_fullscreen_output();
+            return;
+        }
+
+        auto& ndi_source_window = **ndi_source_window_iterator;
+
+        // Take the newest frame as late as we can, right before it's drawn and presented. Nothing else is drawn, so
+        // this is the only thing between the framesync and the swap.
+        ndi_source_window.poll();
+
+        m_render_gpu_timer->begin();
+        glClear(GL_COLOR_BUFFER_BIT);
+        m_fullscreen_output->render(ndi_source_window.frame_texture().name(), ndi_source_window.frame_width(),
+                                    ndi_source_window.frame_height(), framebuffer_width, framebuffer_height);
+        m_render_gpu_timer->end();
+    }
+
+    update_tally();
+    present();
+}
+
+void Application::present()
+{
+    TraceScope trace_scope("Present");
+    auto present_start_time = std::chrono::steady_clock::now();
+    glfwSwapBuffers(m_window);
+    auto presented_at = std::chrono::steady_clock::now();
+    auto present_milliseconds = std::chrono::duration<double, std::milli>(presented_at - present_start_time).count();
+
+    m_average_present_milliseconds += (present_milliseconds - m_average_present_milliseconds) * 0.1;
+
+    std::lock_guard ndi_source_windows_lock(m_ndi_source_windows_mutex);
+    for (auto& ndi_source_window : m_ndi_source_windows)
+        ndi_source_window->frame_presented(presented_at);
+}
+
+double Application::frame_time_budget_fraction_used() const
+{
+    double target_frame_milliseconds;
+    if (m_present_mode == PresentMode::FrameRateLimited)
+        target_frame_milliseconds = 1000.0 / m_frame_rate_limit;
+    else if (auto* video_mode = glfwGetVideoMode(glfwGetPrimaryMonitor()); video_mode && video_mode->refreshRate > 0)
+        target_frame_milliseconds = 1000.0 / video_mode->refreshRate;
+    else
+        target_frame_milliseconds = 1000.0 / 60.0;
+
+    auto gpu_milliseconds = m_render_gpu_timer->average_milliseconds();
+    if (m_is_multiviewer_enabled)
+        gpu_milliseconds += m_multiviewer_gpu_timer->average_milliseconds();
+
+    // Either side falling behind will cost us frames.
+    auto frame_milliseconds = std::max(m_average_frame_work_milliseconds, gpu_milliseconds);
+
+    return frame_milliseconds / target_frame_milliseconds;
+}
+
+void Application::update_automatic_bandwidth()
+{
+    auto budget_fraction_used = frame_time_budget_fraction_used();
+    if (budget_fraction_used > s_frame_time_budget_fraction)
+        m_is_over_frame_time_budget = true;
+    else if (budget_fraction_used < s_frame_time_under_budget_fraction)
+        m_is_over_frame_time_budget = false;
+
+    std::lock_guard ndi_source_windows_lock(m_ndi_source_windows_mutex);
+    for (auto& ndi_source_window : m_ndi_source_windows)
+        ndi_source_window->update_automatic_bandwidth(m_is_over_frame_time_budget);
+}
+
+void Application::update_tally()
+{
+    // Whilst minimized, nothing is being shown at all.
+    auto is_iconified = glfwGetWindowAttrib(m_window, GLFW_ICONIFIED) != 0;
+
+    std::lock_guard ndi_source_windows_lock(m_ndi_source_windows_mutex);
+
+    for (auto& ndi_source_window : m_ndi_source_windows)
+    {
+        // The fullscreen output only draws its one source, so every other source is hidden behind it.
+        ViewState view_state;
+        if (!is_iconified && !m_fullscreen_output_source_name.empty())
+            view_state = ndi_source_window->source().name() == m_fullscreen_output_source_name ? ViewState::Fullscreen
+                                                                                                 : ViewState::Hidden;
+        else if (!is_iconified && ndi_source_window->is_window_focused())
+            view_state = ViewState::Focused;
+        else if (!is_iconified && ndi_source_window->is_visible())
+            view_state = ViewState::Visible;
+        else
+            view_state = ViewState::Hidden;
+
+        auto tally = m_is_tally_enabled ? m_tally_mapping[static_cast<int>(view_state)] : 0;
+        ndi_source_window->set_tally((tally & s_tally_program) != 0, (tally & s_tally_preview) != 0);
+    }
+}
+
+void Application::draw_statistics_window()
+{
+    if (!ImGui::Begin("Statistics", &m_is_statistics_window_open))
+    {
+        ImGui::End();
+        return;
+    }
+
+    auto& io = ImGui::GetIO();
+    ImGui::Text("%.1f FPS (%.2f ms CPU frame time)", io.Framerate, 1000.0f / io.Framerate);
+
+    if (ImGui::CollapsingHeader("GPU Time", ImGuiTreeNodeFlags_DefaultOpen) &&
+        ImGui::BeginTable("GPU Time", 2, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+    {
+        ImGui::TableSetupColumn("Phase");
+        ImGui::TableSetupColumn("Time");
+        ImGui::TableHeadersRow();
+
+        auto row = [](const char* phase, double milliseconds) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(phase);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f ms", milliseconds);
+        };
+
+        double total_upload_milliseconds{};
+
+        {
+            std::lock_guard ndi_source_windows_lock(m_ndi_source_windows_mutex);
+
+            for (auto& ndi_source_window : m_ndi_source_windows)
+            {
+                auto upload_milliseconds = ndi_source_window->upload_timer().average_milliseconds();
+                total_upload_milliseconds += upload_milliseconds;
+
+                auto label = "Upload: " + std::string(ndi_source_window->source().name());
+                row(label.c_str(), upload_milliseconds);
+            }
+        }
+
+        row("Upload (all sources)", total_upload_milliseconds);
+        if (m_is_multiviewer_enabled)
+            row("Multiviewer tile copies", m_multiviewer_gpu_timer->average_milliseconds());
+        row("Render", m_render_gpu_timer->average_milliseconds());
+        row("Present (CPU wait)", m_average_present_milliseconds);
+
+        ImGui::EndTable();
+    }
+
+    if (ImGui::CollapsingHeader("Frame Pacing", ImGuiTreeNodeFlags_DefaultOpen) &&
+        ImGui::BeginTable("Frame Pacing", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+    {
+        ImGui::TableSetupColumn("Source");
+        ImGui::TableSetupColumn("Expected");
+        ImGui::TableSetupColumn("Average");
+        ImGui::TableSetupColumn("Longest");
+        ImGui::TableSetupColumn("Repeated");
+        ImGui::TableSetupColumn("Skipped");
+        ImGui::TableHeadersRow();
+
+        std::lock_guard ndi_source_windows_lock(m_ndi_source_windows_mutex);
+
+        for (auto& ndi_source_window : m_ndi_source_windows)
+        {
+            auto& frame_pacing = ndi_source_window->frame_pacing();
+            auto name = ndi_source_window->source().name();
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(name.data(), name.data() + name.size());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f ms", frame_pacing.expected_interval_milliseconds());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f ms", frame_pacing.average_interval_milliseconds());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f ms", frame_pacing.maximum_interval_milliseconds());
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", static_cast<unsigned long long>(frame_pacing.number_of_repeated_frames()));
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", static_cast<unsigned long long>(frame_pacing.number_of_skipped_frames()));
+        }
+
+        ImGui::EndTable();
+    }
+
+    if (ImGui::CollapsingHeader("Receivers", ImGuiTreeNodeFlags_DefaultOpen) &&
+        ImGui::BeginTable("Receivers", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+    {
+        ImGui::TableSetupColumn("Source");
+        ImGui::TableSetupColumn("Video frames");
+        ImGui::TableSetupColumn("Dropped");
+        ImGui::TableSetupColumn("Drop rate (last second)");
+        ImGui::TableSetupColumn("Video queue");
+        ImGui::TableHeadersRow();
+
+        std::lock_guard ndi_source_windows_lock(m_ndi_source_windows_mutex);
+
+        for (auto& ndi_source_window : m_ndi_source_windows)
+        {
+            auto statistics = ndi_source_window->receiver_statistics().snapshot();
+            auto name = ndi_source_window->source().name();
+
+            ImGui::PushID(ndi_source_window.get());
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(name.data(), name.data() + name.size());
+            ImGui::TableNextColumn();
+            ImGui::Text("%lld", static_cast<long long>(statistics.total_video_frames));
+            ImGui::TableNextColumn();
+            ImGui::Text("%lld (%.2f%%)", static_cast<long long>(statistics.dropped_video_frames),
+                        statistics.video_drop_rate() * 100.0f);
+            ImGui::TableNextColumn();
+            ImGui::PlotLines("##Drop rate", statistics.video_drop_rate_history.data(), statistics.history_size, 0,
+                             nullptr, 0.0f, 1.0f, ImVec2(120.0f, 20.0f));
+            ImGui::SameLine();
+            ImGui::Text("%.2f%%", statistics.recent_video_drop_rate * 100.0f);
+            ImGui::TableNextColumn();
+            ImGui::PlotLines("##Video queue", statistics.video_queue_depth_history.data(), statistics.history_size, 0,
+                             nullptr, 0.0f, FLT_MAX, ImVec2(120.0f, 20.0f));
+            ImGui::SameLine();
+            ImGui::Text("%d", statistics.video_queue_depth);
+            ImGui::PopID();
+        }
+
+        ImGui::EndTable();
+    }
+
+    if (!m_statistics_export_path.empty())
+        ImGui::TextDisabled("Exporting receiver statistics to %s", m_statistics_export_path.c_str());
+
+    if (ImGui::Button("Reset Frame Pacing"))
+    {
+        std::lock_guard ndi_source_windows_lock(m_ndi_source_windows_mutex);
+        for (auto& ndi_source_window : m_ndi_source_windows)
+            ndi_source_window->reset_frame_pacing();
+    }
+
+    ImGui::End();
+}
+
+void Application::sample_receiver_statistics(std::stop_token stop_token)
+{
+    std::vector<std::shared_ptr<const ReceiverStatistics>> sampled_receiver_statistics;
+    std::vector<std::pair<std::string, ReceiverStatistics::Snapshot>> receiver_statistics;
+
+    while (true)
+    {
+        {
+            std::unique_lock lock(m_receiver_statistics_mutex);
+            m_receiver_statistics_condition.wait_for(lock, stop_token, s_receiver_statistics_interval,
+                                                     []() { return false; });
+        }
+
+        if (stop_token.stop_requested())
+            return;
+
+        // The audio callback takes the source windows lock too, so we mustn't allocate whilst we have it. Make room for
+        // every window beforehand, and go round again if more were opened in the meantime.
+        size_t number_of_windows = 0;
+        while (true)
+        {
+            sampled_receiver_statistics.reserve(number_of_windows);
+
+            std::lock_guard ndi_source_windows_lock(m_ndi_source_windows_mutex);
+            if (m_ndi_source_windows.size() > sampled_receiver_statistics.capacity())
+            {
+                number_of_windows = m_ndi_source_windows.size();
+                continue;
+            }
+
+            for (auto& ndi_source_window : m_ndi_source_windows)
+            {
+                ndi_source_window->sample_receiver_statistics();
+                sampled_receiver_statistics.push_back(ndi_source_window->shared_receiver_statistics());
+            }
+
+            break;
+        }
+
+        if (!m_statistics_export_path.empty())
+        {
+            receiver_statistics.clear();
+            for (auto& statistics : sampled_receiver_statistics)
+                receiver_statistics.emplace_back(statistics->source_name(), statistics->snapshot());
+
+            export_receiver_statistics(receiver_statistics);
+        }
+
+        sampled_receiver_statistics.clear();
+    }
+}
+
+void Application::export_receiver_statistics(
+    std::span<const std::pair<std::string, ReceiverStatistics::Snapshot>> receiver_statistics) const
+{
+    PrometheusTextFile metrics;
+    ReceiverStatistics::add_metrics(metrics, receiver_statistics);
+    metrics.write(m_statistics_export_path);
+}
+
+void Application::update_multiviewer()
+{
+    TraceScope trace_scope("Update multiviewer");
+    if (!m_multiviewer)
+    {
+        try
+        {
+            m_multiviewer = std::make_unique<Multiviewer>();
+        }
+        catch (const std::exception& ex)
+        {
+            fprintf(stderr, "Failed to create multiviewer: %s\n", ex.what());
+            m_is_multiviewer_enabled = false;
+            return;
+        }
+    }
+
+    m_multiviewer->set_columns(m_multiviewer_columns);
+    m_multiviewer->set_tile_texture_height(m_multiviewer_tile_texture_height);
+
+    std::lock_guard ndi_source_windows_lock(m_ndi_source_windows_mutex);
+
+    std::vector<Multiviewer::Tile> tiles;
+    tiles.reserve(m_ndi_source_windows.size());
+
+    for (auto& ndi_source_window : m_ndi_source_windows)
+    {
+        auto is_selected = ndi_source_window->source().name() == m_multiviewer_selected_source_name;
+        ndi_source_window->set_window_focused(is_selected);
+        // Tiles are copied at this size, so anything more than that is wasted.
+        ndi_source_window->set_displayed_height(static_cast<float>(m_multiviewer_tile_texture_height));
+
+        ImVec4 border_color(0.2f, 0.2f, 0.2f, 1.0f);
+        if (is_selected)
+            border_color = ImVec4(1.0f, 0.0f, 0.0f, 1.0f);
+        else if (ndi_source_window->frame_serial() == 0)
+            border_color = ImVec4(0.5f, 0.5f, 0.0f, 1.0f);
+
+        tiles.push_back({ndi_source_window->frame_texture().name(), ndi_source_window->frame_width(),
+                         ndi_source_window->frame_height(), ndi_source_window->frame_serial(),
+                         ndi_source_window->source().name(), border_color});
+    }
+
+    auto* viewport = ImGui::GetMainViewport();
+    auto clicked_tile_index = m_multiviewer->update(tiles, viewport->WorkPos, viewport->WorkSize);
+
+    if (clicked_tile_index)
+        m_multiviewer_selected_source_name = m_ndi_source_windows[*clicked_tile_index]->source().name();
+}
+
+void Application::update_multiviewer_output()
+{
+    if (!m_is_multiviewer_output_enabled || !m_is_multiviewer_enabled || !m_multiviewer)
+    {
+        m_multiviewer_output.reset();
+        return;
+    }
+
+    if (m_multiviewer_output && (m_multiviewer_output->name() != m_multiviewer_output_name ||
+                                 m_multiviewer_output->height() != m_multiviewer_output_height))
+        m_multiviewer_output.reset();
+
+    if (!m_multiviewer_output)
+    {
+        try
+        {
+            m_multiviewer_output = std::make_unique<MultiviewerOutput>(
+                m_multiviewer_output_name, m_multiviewer_output_height * 16 / 9, m_multiviewer_output_height);
+        }
+        catch (const std::exception& ex)
+        {
+            fprintf(stderr, "Failed to create multiviewer output: %s\n", ex.what());
+            m_is_multiviewer_output_enabled = false;
+            return;
+        }
+    }
+
+    m_multiviewer_output->update(*m_multiviewer, ImGui::GetIO().DisplaySize);
+}
+
+void Application::draw_multiviewer_output_menu()
+{
+    if (ImGui::MenuItem("Send As NDI Source", nullptr, &m_is_multiviewer_output_enabled))
+        ImGui::MarkIniSettingsDirty();
+
+    char name[256];
+    snprintf(name, sizeof(name), "%s", m_multiviewer_output_name.c_str());
+    if (ImGui::InputText("Name", name, sizeof(name), ImGuiInputTextFlags_EnterReturnsTrue) && name[0] != '\0')
+    {
+        m_multiviewer_output_name = name;
+        ImGui::MarkIniSettingsDirty();
+    }
+
+    for (auto height : {720, 1080, 2160})
+    {
+        auto label = std::to_string(height) + "p";
+        if (ImGui::MenuItem(label.c_str(), nullptr, m_multiviewer_output_height == height))
+        {
+            m_multiviewer_output_height = height;
+            ImGui::MarkIniSettingsDirty();
+        }
+    }
+
+    ImGui::Separator();
+
+    if (!m_multiviewer_output)
+    {
+        ImGui::TextDisabled(m_is_multiviewer_output_enabled ? "Only sent whilst the multiviewer is shown"
+                                                            : "Not sending");
+        return;
+    }
+
+    ImGui::Text("%d connections", m_multiviewer_output->number_of_connections());
+    ImGui::Text("%llu frames sent, %llu dropped",
+                static_cast<unsigned long long>(m_multiviewer_output->number_of_sent_frames()),
+                static_cast<unsigned long long>(m_multiviewer_output->number_of_dropped_frames()));
+}
+
+bool Application::poll_source_windows()
+{
+    TraceScope trace_scope("Poll sources");
+    std::lock_guard ndi_source_windows_lock(m_ndi_source_windows_mutex);
+
+    auto has_changed = false;
+    for (auto& ndi_source_window : m_ndi_source_windows)
+        has_changed |= ndi_source_window->poll();
+
+    return has_changed;
+}
+
+void Application::glfw_event_callback(GLFWwindow* window)
+{
+    auto& application = *reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
+    application.m_frames_to_render = s_frames_to_render_after_event;
+}
+
 void Application::create_finder()
 {
     if (m_ndi_finder_instance)
@@ -278,6 +1171,213 @@ void Application::create_finder()
         throw std::runtime_error("Failed to create NDI finder instance");
 }
 
+void Application::open_source_window(const NDIlib_source_t& source)
+{
+    printf("Connecting to source %s\n", source.p_ndi_name);
+
+    try
+    {
+        auto source_window = std::make_unique<NDISourceWindow>(source, m_receiver_reaper);
+        std::lock_guard ndi_source_windows_lock(m_ndi_source_windows_mutex);
+        m_ndi_source_windows.push_back(std::move(source_window));
+        ImGui::MarkIniSettingsDirty();
+    }
+    catch (const std::exception& ex)
+    {
+        fprintf(stderr, "Failed to create NDI source window: %s\n", ex.what());
+    }
+}
+
+void Application::draw_source_browser()
+{
+    if (!m_source_browser)
+        m_source_browser = std::make_unique<SourceBrowser>(m_receiver_reaper);
+
+    m_source_browser->update(m_found_ndi_sources);
+
+    auto clicked_source = m_source_browser->draw(&m_is_source_browser_open);
+    if (!m_is_source_browser_open)
+        ImGui::MarkIniSettingsDirty();
+
+    if (!clicked_source)
+        return;
+
+    // Like the sources menu, we only ever have one window per source.
+    auto ndi_source = clicked_source->to_ndi_source();
+    if (std::none_of(m_ndi_source_windows.begin(), m_ndi_source_windows.end(),
+                     [&ndi_source](const auto& source_window) { return source_window->source() == ndi_source; }))
+        open_source_window(ndi_source);
+}
+
+void Application::draw_tracing_menu()
+{
+    auto is_tracing_enabled = Tracer::is_enabled();
+    if (ImGui::MenuItem("Record Trace", nullptr, &is_tracing_enabled))
+        Tracer::set_enabled(is_tracing_enabled);
+
+    if (ImGui::MenuItem("Save Trace"))
+    {
+        auto now = std::time(nullptr);
+        char saved_at[32];
+        std::strftime(saved_at, sizeof(saved_at), "%Y%m%d-%H%M%S", std::localtime(&now));
+
+        auto path = std::string("carousel-trace-") + saved_at + ".json";
+        if (Tracer::write(path))
+            m_trace_status = "Saved to " + path;
+        else
+            m_trace_status = "Failed to write " + path;
+    }
+
+    ImGui::Separator();
+    ImGui::TextDisabled("%s", m_trace_status.empty() ? "Open saved traces in Perfetto or chrome://tracing"
+                                                     : m_trace_status.c_str());
+}
+
+void Application::draw_routes_menu()
+{
+    std::optional<size_t> removed_route_index;
+
+    for (size_t i = 0; i < m_routes.size(); i++)
+    {
+        auto& route = m_routes[i];
+        ImGui::PushID(static_cast<int>(i));
+
+        auto label = route->name() + " (" +
+                     (route->source_name().empty() ? std::string("Nothing") : std::string(route->source_name())) + ")";
+
+        if (ImGui::BeginMenu(label.c_str()))
+        {
+            if (ImGui::MenuItem("Nothing", nullptr, route->source_name().empty()))
+            {
+                route->clear();
+                ImGui::MarkIniSettingsDirty();
+            }
+
+            ImGui::Separator();
+
+            auto has_shown_source = false;
+            for (auto& source : m_found_ndi_sources)
+            {
+                // Pointing a route at itself, or at another of ours that points back, would just loop forever.
+                if (std::any_of(m_routes.begin(), m_routes.end(),
+                                [&source](const auto& own_route) { return own_route->is_own_source(source); }))
+                    continue;
+
+                has_shown_source = true;
+
+                if (ImGui::MenuItem(source.p_ndi_name, nullptr, route->is_routed_to(source)))
+                {
+                    try
+                    {
+                        route->route_to(source);
+                        ImGui::MarkIniSettingsDirty();
+                    }
+                    catch (const std::exception& ex)
+                    {
+                        fprintf(stderr, "Failed to route %s to %s: %s\n", route->name().c_str(), source.p_ndi_name,
+                                ex.what());
+                    }
+                }
+            }
+
+            if (!has_shown_source)
+                ImGui::TextDisabled("No sources found");
+
+            ImGui::Separator();
+            ImGui::TextDisabled("%d connections", route->number_of_connections());
+
+            if (ImGui::MenuItem("Remove Route"))
+                removed_route_index = i;
+
+            ImGui::EndMenu();
+        }
+
+        ImGui::PopID();
+    }
+
+    if (removed_route_index)
+    {
+        m_routes.erase(m_routes.begin() + static_cast<ptrdiff_t>(*removed_route_index));
+        ImGui::MarkIniSettingsDirty();
+    }
+
+    if (!m_routes.empty())
+        ImGui::Separator();
+
+    // ImGui keeps what's being typed itself whilst the field is active, so this only has to hold it once Enter is
+    // pressed.
+    char name[256]{};
+    if (ImGui::InputText("New Route", name, sizeof(name), ImGuiInputTextFlags_EnterReturnsTrue) && name[0] != '\0')
+    {
+        if (std::any_of(m_routes.begin(), m_routes.end(), [&name](const auto& route) { return route->name() == name; }))
+        {
+            fprintf(stderr, "There is already a route named %s\n", name);
+        }
+        else
+        {
+            try
+            {
+                m_routes.push_back(std::make_unique<NDIRoute>(name));
+                ImGui::MarkIniSettingsDirty();
+            }
+            catch (const std::exception& ex)
+            {
+                fprintf(stderr, "Failed to create NDI route %s: %s\n", name, ex.what());
+            }
+        }
+    }
+}
+
+void Application::restore_session()
+{
+    for (auto& session_route : m_session_routes)
+    {
+        try
+        {
+            auto& route = m_routes.emplace_back(std::make_unique<NDIRoute>(session_route.name));
+            if (!session_route.source_name.empty())
+            {
+                route->route_to(NDIlib_source_t(session_route.source_name.c_str(),
+                                                session_route.source_url_address.empty()
+                                                    ? nullptr
+                                                    : session_route.source_url_address.c_str()));
+            }
+        }
+        catch (const std::exception& ex)
+        {
+            fprintf(stderr, "Failed to restore NDI route %s: %s\n", session_route.name.c_str(), ex.what());
+        }
+    }
+
+    m_session_routes.clear();
+
+    if (m_session_sources.empty())
+        return;
+
+    printf("Restoring %zu source(s) from the previous session\n", m_session_sources.size());
+
+    // Each window creates its receiver on another thread, so these will all connect at the same time.
+    for (auto& session_source : m_session_sources)
+    {
+        try
+        {
+            auto source_window = std::make_unique<NDISourceWindow>(
+                NDISourceWindow::Source(session_source.name, session_source.url_address), session_source.settings,
+                m_receiver_reaper);
+
+            std::lock_guard ndi_source_windows_lock(m_ndi_source_windows_mutex);
+            m_ndi_source_windows.push_back(std::move(source_window));
+        }
+        catch (const std::exception& ex)
+        {
+            fprintf(stderr, "Failed to restore NDI source window for %s: %s\n", session_source.name.c_str(),
+                    ex.what());
+        }
+    }
+
+    m_session_sources.clear();
+}
+
 bool Application::initialize_playback_device(ma_device_info* device_info)
 {
     if (m_playback_device.pUserData)
@@ -301,6 +1401,9 @@ bool Application::initialize_playback_device(ma_device_info* device_info)
 
 void Application::miniaudio_playback_data_callback(ma_device* device, void* output, const void*, ma_uint32 frame_count)
 {
+    Tracer::set_thread_name("Audio");
+    TraceScope trace_scope("Audio callback");
+
     auto& application = *reinterpret_cast<Application*>(device->pUserData);
     auto output_floats = reinterpret_cast<float*>(output);
 
@@ -313,20 +1416,29 @@ void Application::miniaudio_playback_data_callback(ma_device* device, void* outp
 
     for (auto& ndi_source_window : application.m_ndi_source_windows)
     {
+        // Receivers in direct mode only capture video, so there's no audio for us here.
+        auto receiver = ndi_source_window->receiver();
+        if (!receiver || !receiver->framesync_instance())
+            continue;
+
         NDIlib_audio_frame_v2_t audio_frame;
         // Even if the source window is muted, we need to consume the capture for the sync... I think.
         // Without this, muting and unmuting the audio rapidly for a few seconds quickly made it desync. It doesn't cost
         // us much to do this anyhow.
-        NDIlib_framesync_capture_audio(ndi_source_window->framesync_instance(), &audio_frame,
+        NDIlib_framesync_capture_audio(receiver->framesync_instance(), &audio_frame,
                                        static_cast<int>(device->playback.internalSampleRate),
                                        static_cast<int>(device->playback.channels), static_cast<int>(frame_count));
 
-        JMP::ScopeGuard free_audio_frame = [&ndi_source_window, &audio_frame]() {
-            NDIlib_framesync_free_audio(ndi_source_window->framesync_instance(), &audio_frame);
+        JMP::ScopeGuard free_audio_frame = [receiver, &audio_frame]() {
+            NDIlib_framesync_free_audio(receiver->framesync_instance(), &audio_frame);
         };
 
-        if (application.m_only_play_audio_from_focused_window && !ndi_source_window->is_window_focused() ||
-            ndi_source_window->is_audio_muted())
+        auto is_audible =
+            !(application.m_only_play_audio_from_focused_window && !ndi_source_window->is_window_focused() ||
+              ndi_source_window->is_audio_muted());
+
+        // Audio only windows show meters, which want the samples even when we aren't playing them.
+        if (!is_audible && !ndi_source_window->is_audio_only())
             continue;
 
         NDIlib_audio_frame_interleaved_32f_t audio_frame_interleaved_floats;
@@ -337,6 +1449,15 @@ void Application::miniaudio_playback_data_callback(ma_device* device, void* outp
 
         NDIlib_util_audio_to_interleaved_32f_v2(&audio_frame, &audio_frame_interleaved_floats);
 
+        if (ndi_source_window->is_audio_only())
+        {
+            ndi_source_window->record_audio_levels(samples_for_this_source, static_cast<int>(frame_count),
+                                                   static_cast<int>(device->playback.channels));
+        }
+
+        if (!is_audible)
+            continue;
+
         for (auto i = 0; i < total_number_of_frames_for_all_channels; i++)
         {
             auto mixed = std::clamp(output_floats[i] + (samples_for_this_source[i] * ndi_source_window->audio_volume()),
@@ -349,4 +1470,190 @@ void Application::miniaudio_playback_data_callback(ma_device* device, void* outp
         // to be sure to at least consume the audio from all sources.
     }
 }
-}
\ No newline at end of file
+
+void* Application::settings_read_open(ImGuiContext*, ImGuiSettingsHandler* handler, const char* name)
+{
+    // The application's own settings are read straight into it, see settings_read_line().
+    if (strcmp(name, "Application") == 0)
+        return handler->UserData;
+
+    auto& application = *reinterpret_cast<Application*>(handler->UserData);
+
+    if (strcmp(name, "Route") == 0)
+        return &application.m_session_routes.emplace_back();
+
+    if (strcmp(name, "Source") != 0)
+        return nullptr;
+
+    // Lines for an entry are always read before the next entry is opened, so this pointer only has to survive until
+    // then.
+    return &application.m_session_sources.emplace_back();
+}
+
+void Application::settings_read_line(ImGuiContext*, ImGuiSettingsHandler* handler, void* entry, const char* line)
+{
+    int value{};
+    float float_value{};
+
+    if (entry == handler->UserData)
+    {
+        auto& application = *reinterpret_cast<Application*>(entry);
+
+        if (sscanf(line, "RenderOnDemand=%d", &value) == 1)
+            application.m_render_on_demand = value != 0;
+        else if (sscanf(line, "PresentMode=%d", &value) == 1 && value >= 0 &&
+                 value <= static_cast<int>(PresentMode::FrameRateLimited))
+            application.m_present_mode = static_cast<PresentMode>(value);
+        else if (sscanf(line, "FrameRateLimit=%d", &value) == 1)
+            application.m_frame_rate_limit = std::clamp(value, 10, 500);
+        else if (sscanf(line, "ShowStatistics=%d", &value) == 1)
+            application.m_is_statistics_window_open = value != 0;
+        else if (sscanf(line, "ShowSourceBrowser=%d", &value) == 1)
+            application.m_is_source_browser_open = value != 0;
+        else if (sscanf(line, "Multiviewer=%d", &value) == 1)
+            application.m_is_multiviewer_enabled = value != 0;
+        else if (sscanf(line, "MultiviewerColumns=%d", &value) == 1)
+            application.m_multiviewer_columns = std::clamp(value, 0, 16);
+        else if (sscanf(line, "MultiviewerTileHeight=%d", &value) == 1)
+            application.m_multiviewer_tile_texture_height = std::clamp(value, 144, 2160);
+        else if (sscanf(line, "MultiviewerOutput=%d", &value) == 1)
+            application.m_is_multiviewer_output_enabled = value != 0;
+        else if (strncmp(line, "MultiviewerOutputName=", 22) == 0)
+            application.m_multiviewer_output_name = line + 22;
+        else if (sscanf(line, "MultiviewerOutputHeight=%d", &value) == 1)
+            application.m_multiviewer_output_height = std::clamp(value, 144, 2160) & ~1;
+        else if (strncmp(line, "StatisticsExportPath=", 21) == 0)
+            application.m_statistics_export_path = line + 21;
+        else if (strncmp(line, "RecordingDirectory=", 19) == 0)
+            application.m_recording_directory = line + 19;
+        else if (sscanf(line, "Tally=%d", &value) == 1)
+            application.m_is_tally_enabled = value != 0;
+        else if (sscanf(line, "TallyHidden=%d", &value) == 1)
+            application.m_tally_mapping[static_cast<int>(ViewState::Hidden)] = value & 3;
+        else if (sscanf(line, "TallyVisible=%d", &value) == 1)
+            application.m_tally_mapping[static_cast<int>(ViewState::Visible)] = value & 3;
+        else if (sscanf(line, "TallyFocused=%d", &value) == 1)
+            application.m_tally_mapping[static_cast<int>(ViewState::Focused)] = value & 3;
+        else if (sscanf(line, "TallyFullscreen=%d", &value) == 1)
+            application.m_tally_mapping[static_cast<int>(ViewState::Fullscreen)] = value & 3;
+
+        return;
+    }
+
+    auto& application = *reinterpret_cast<Application*>(handler->UserData);
+
+    // Whichever entry is being read was always the last one opened.
+    if (!application.m_session_routes.empty() && entry == &application.m_session_routes.back())
+    {
+        auto& session_route = application.m_session_routes.back();
+
+        if (strncmp(line, "Name=", 5) == 0)
+            session_route.name = line + 5;
+        else if (strncmp(line, "Source=", 7) == 0)
+            session_route.source_name = line + 7;
+        else if (strncmp(line, "SourceURL=", 10) == 0)
+            session_route.source_url_address = line + 10;
+
+        return;
+    }
+
+    auto& session_source = *reinterpret_cast<SessionSource*>(entry);
+
+    if (strncmp(line, "Name=", 5) == 0)
+        session_source.name = line + 5;
+    else if (strncmp(line, "URL=", 4) == 0)
+        session_source.url_address = line + 4;
+    else if (sscanf(line, "Bandwidth=%d", &value) == 1 &&
+             (value == NDIlib_recv_bandwidth_metadata_only || value == NDIlib_recv_bandwidth_audio_only ||
+              value == NDIlib_recv_bandwidth_lowest || value == NDIlib_recv_bandwidth_highest))
+        session_source.settings.bandwidth = static_cast<NDIlib_recv_bandwidth_e>(value);
+    else if (sscanf(line, "Filtering=%d", &value) == 1)
+        session_source.settings.frame_texture_filtering = value;
+    else if (sscanf(line, "Volume=%f", &float_value) == 1)
+        session_source.settings.audio_volume = std::clamp(float_value, 0.0f, 1.0f);
+    else if (sscanf(line, "Muted=%d", &value) == 1)
+        session_source.settings.audio_muted = value != 0;
+    else if (sscanf(line, "AutomaticBandwidth=%d", &value) == 1)
+        session_source.settings.automatic_bandwidth = value != 0;
+    else if (sscanf(line, "ReceiveMode=%d", &value) == 1 && value >= 0 &&
+             value <= static_cast<int>(NDIReceiver::ReceiveMode::Direct))
+        session_source.settings.receive_mode = static_cast<NDIReceiver::ReceiveMode>(value);
+    else if (sscanf(line, "JitterBuffer=%d", &value) == 1)
+        session_source.settings.jitter_buffer_frames = std::clamp(value, 0, 8);
+    else if (sscanf(line, "GPUDeinterlacing=%d", &value) == 1)
+        session_source.settings.gpu_deinterlacing = value != 0;
+    else if (sscanf(line, "DeinterlacingMode=%d", &value) == 1 && value >= 0 &&
+             value <= static_cast<int>(Deinterlacer::Mode::MotionAdaptive))
+        session_source.settings.deinterlacing_mode = static_cast<Deinterlacer::Mode>(value);
+    else if (sscanf(line, "ReplaySeconds=%d", &value) == 1)
+        session_source.settings.replay_seconds = std::clamp(value, 0, NDISourceWindow::s_maximum_replay_seconds);
+    else if (sscanf(line, "ReplayBudget=%d", &value) == 1)
+        session_source.settings.replay_budget_megabytes =
+            std::clamp(value, NDISourceWindow::s_minimum_replay_budget_megabytes,
+                       NDISourceWindow::s_maximum_replay_budget_megabytes);
+}
+
+void Application::settings_write_all(ImGuiContext*, ImGuiSettingsHandler* handler, ImGuiTextBuffer* buffer)
+{
+    auto& application = *reinterpret_cast<Application*>(handler->UserData);
+
+    buffer->appendf("[%s][Application]\n", handler->TypeName);
+    buffer->appendf("RenderOnDemand=%d\n", application.m_render_on_demand);
+    buffer->appendf("PresentMode=%d\n", static_cast<int>(application.m_present_mode));
+    buffer->appendf("FrameRateLimit=%d\n", application.m_frame_rate_limit);
+    buffer->appendf("ShowStatistics=%d\n", application.m_is_statistics_window_open);
+    buffer->appendf("ShowSourceBrowser=%d\n", application.m_is_source_browser_open);
+    buffer->appendf("Multiviewer=%d\n", application.m_is_multiviewer_enabled);
+    buffer->appendf("MultiviewerColumns=%d\n", application.m_multiviewer_columns);
+    buffer->appendf("MultiviewerTileHeight=%d\n", application.m_multiviewer_tile_texture_height);
+    buffer->appendf("MultiviewerOutput=%d\n", application.m_is_multiviewer_output_enabled);
+    buffer->appendf("MultiviewerOutputName=%s\n", application.m_multiviewer_output_name.c_str());
+    buffer->appendf("MultiviewerOutputHeight=%d\n", application.m_multiviewer_output_height);
+    buffer->appendf("Tally=%d\n", application.m_is_tally_enabled);
+    buffer->appendf("TallyHidden=%d\n", application.m_tally_mapping[static_cast<int>(ViewState::Hidden)]);
+    buffer->appendf("TallyVisible=%d\n", application.m_tally_mapping[static_cast<int>(ViewState::Visible)]);
+    buffer->appendf("TallyFocused=%d\n", application.m_tally_mapping[static_cast<int>(ViewState::Focused)]);
+    buffer->appendf("TallyFullscreen=%d\n", application.m_tally_mapping[static_cast<int>(ViewState::Fullscreen)]);
+    if (!application.m_statistics_export_path.empty())
+        buffer->appendf("StatisticsExportPath=%s\n", application.m_statistics_export_path.c_str());
+    if (!application.m_recording_directory.empty())
+        buffer->appendf("RecordingDirectory=%s\n", application.m_recording_directory.c_str());
+    buffer->append("\n");
+
+    for (auto& ndi_source_window : application.m_ndi_source_windows)
+    {
+        auto& source = ndi_source_window->source();
+        auto& settings = ndi_source_window->settings();
+
+        buffer->appendf("[%s][Source]\n", handler->TypeName);
+        buffer->appendf("Name=%.*s\n", static_cast<int>(source.name().size()), source.name().data());
+        buffer->appendf("URL=%.*s\n", static_cast<int>(source.url_address().size()), source.url_address().data());
+        buffer->appendf("Bandwidth=%d\n", settings.bandwidth);
+        buffer->appendf("Filtering=%d\n", settings.frame_texture_filtering);
+        buffer->appendf("Volume=%f\n", settings.audio_volume);
+        buffer->appendf("Muted=%d\n", settings.audio_muted);
+        buffer->appendf("AutomaticBandwidth=%d\n", settings.automatic_bandwidth);
+        buffer->appendf("ReceiveMode=%d\n", static_cast<int>(settings.receive_mode));
+        buffer->appendf("JitterBuffer=%d\n", settings.jitter_buffer_frames);
+        buffer->appendf("GPUDeinterlacing=%d\n", settings.gpu_deinterlacing);
+        buffer->appendf("DeinterlacingMode=%d\n", static_cast<int>(settings.deinterlacing_mode));
+        buffer->appendf("ReplaySeconds=%d\n", settings.replay_seconds);
+        buffer->appendf("ReplayBudget=%d\n", settings.replay_budget_megabytes);
+        buffer->append("\n");
+    }
+
+    for (auto& route : application.m_routes)
+    {
+        buffer->appendf("[%s][Route]\n", handler->TypeName);
+        buffer->appendf("Name=%s\n", route->name().c_str());
+        if (!route->source_name().empty())
+        {
+            buffer->appendf("Source=%.*s\n", static_cast<int>(route->source_name().size()),
+                            route->source_name().data());
+            buffer->appendf("SourceURL=%.*s\n", static_cast<int>(route->source_url_address().size()),
+                            route->source_url_address().data());
+        }
+        buffer->append("\n");
+    }
+}
+}
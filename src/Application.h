@@ -6,15 +6,32 @@
 
 #pragma once
 
+#include "FullscreenOutput.h"
+#include "GPUTimer.h"
+#include "Multiviewer.h"
+#include "MultiviewerOutput.h"
 #include "NDI.h"
+#include "NDIReceiverReaper.h"
+#include "NDIRoute.h"
 #include "NDISourceWindow.h"
+#include "SourceBrowser.h"
+#include <array>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
 #include <miniaudio.h>
 #include <mutex>
+#include <optional>
 #include <span>
+#include <string>
+#include <thread>
 #include <vector>
 
+struct GLFWmonitor;
 struct GLFWwindow;
+struct ImGuiContext;
+struct ImGuiSettingsHandler;
+struct ImGuiTextBuffer;
 
 namespace Carousel
 {
@@ -28,20 +45,154 @@ public:
     int run();
 
 private:
-    static constexpr bool s_use_vsync = true;
+    enum class PresentMode
+    {
+        VSync,
+        // Like VSync, but a late frame is presented immediately (tearing) instead of waiting for the next refresh.
+        AdaptiveVSync,
+        Uncapped,
+        // No vsync, but we sleep between frames ourselves to stay at m_frame_rate_limit.
+        FrameRateLimited,
+    };
+
+    // We sleep until this far from the deadline, then spin the rest of the way, as sleeps are rarely that precise.
+    static constexpr std::chrono::microseconds s_frame_rate_limiter_spin_duration{1500};
+    // When rendering on demand, we'll still render at least this often even if nothing has changed.
+    static constexpr std::chrono::seconds s_minimum_refresh_interval{1};
+    // ImGui can take a few frames to settle after input (e.g. hover state and popups appearing), so keep rendering for
+    // a little while after any event.
+    static constexpr int s_frames_to_render_after_event = 3;
+    // Receiver statistics only change meaningfully over seconds, and sampling them takes the mixer lock.
+    static constexpr std::chrono::seconds s_receiver_statistics_interval{1};
+    // Automatic bandwidth considers us over budget once a frame takes more than this fraction of the refresh interval,
+    // and only back under it once frames take less than the lower fraction, so the sources it demoted to get us under
+    // budget don't immediately put us back over it.
+    static constexpr double s_frame_time_budget_fraction = 0.8;
+    static constexpr double s_frame_time_under_budget_fraction = 0.5;
+
+    // How a source is being shown, which decides the tally we send for it.
+    enum class ViewState
+    {
+        Hidden,
+        Visible,
+        Focused,
+        Fullscreen,
+    };
+
+    // Tally flags, see m_tally_mapping.
+    static constexpr int s_tally_program = 1 << 0;
+    static constexpr int s_tally_preview = 1 << 1;
+
+    // A source window that was open when the last session ended, read back from imgui.ini.
+    struct SessionSource
+    {
+        std::string name;
+        std::string url_address;
+        NDISourceWindow::Settings settings;
+    };
+
+    // A route that existed when the last session ended, read back from imgui.ini.
+    struct SessionRoute
+    {
+        std::string name;
+        std::string source_name;
+        std::string source_url_address;
+    };
 
     GLFWwindow* m_window{};
     NDIlib_find_instance_t m_ndi_finder_instance{};
     std::span<const NDIlib_source_t> m_found_ndi_sources{};
+    // Must outlive the source windows, which hand it their receivers as they are destroyed.
+    NDIReceiverReaper m_receiver_reaper;
     std::vector<std::unique_ptr<NDISourceWindow>> m_ndi_source_windows;
     std::mutex m_ndi_source_windows_mutex;
     ma_context m_audio_context{};
     std::span<ma_device_info> m_playback_device_infos;
     ma_device m_playback_device{};
     bool m_only_play_audio_from_focused_window{};
+    std::vector<SessionSource> m_session_sources;
+    // Only exists whilst it's open.
+    std::unique_ptr<SourceBrowser> m_source_browser;
+    bool m_is_source_browser_open{};
+    std::vector<std::unique_ptr<NDIRoute>> m_routes;
+    std::vector<SessionRoute> m_session_routes;
+    bool m_render_on_demand{};
+    PresentMode m_present_mode = PresentMode::VSync;
+    int m_frame_rate_limit = 60;
+    bool m_is_adaptive_vsync_supported{};
+    std::chrono::steady_clock::time_point m_next_frame_deadline;
+    // Created the first time the multiviewer is enabled.
+    std::unique_ptr<Multiviewer> m_multiviewer;
+    bool m_is_multiviewer_enabled{};
+    int m_multiviewer_columns{};
+    int m_multiviewer_tile_texture_height = 360;
+    std::string m_multiviewer_selected_source_name;
+    // Only exists whilst it's enabled and the multiviewer is being shown.
+    std::unique_ptr<MultiviewerOutput> m_multiviewer_output;
+    bool m_is_multiviewer_output_enabled{};
+    std::string m_multiviewer_output_name = "Multiviewer";
+    int m_multiviewer_output_height = 1080;
+    std::unique_ptr<FullscreenOutput> m_fullscreen_output;
+    // Empty when the fullscreen output isn't being shown.
+    std::string m_fullscreen_output_source_name;
+    int m_windowed_x{}, m_windowed_y{}, m_windowed_width{}, m_windowed_height{};
+    bool m_is_statistics_window_open{};
+    // Where the last trace was saved to, or why it couldn't be.
+    std::string m_trace_status;
+    // These are created once we have a GL context.
+    std::optional<GPUTimer> m_multiviewer_gpu_timer;
+    std::optional<GPUTimer> m_render_gpu_timer;
+    // Swapping can block the CPU, but can't be measured with a timer query, so we time it from the CPU instead.
+    double m_average_present_milliseconds{};
+    // From the start of a frame up to presenting it, not counting any time spent waiting to present.
+    double m_average_frame_work_milliseconds{};
+    bool m_is_over_frame_time_budget{};
+    int m_frames_to_render{};
+    std::chrono::steady_clock::time_point m_last_render_time;
+    // If set, receiver statistics are written here (in the Prometheus text format) every time they are sampled. Only
+    // read from imgui.ini, so it doesn't change once the statistics thread is running.
+    std::string m_statistics_export_path;
+    // Where recordings go. Only read from imgui.ini; empty means the working directory.
+    std::string m_recording_directory;
+    bool m_is_tally_enabled = true;
+    // The tally flags to send for each ViewState. Program tally usually lights a camera's red light, so by default we
+    // only ever claim preview.
+    std::array<int, 4> m_tally_mapping{0, s_tally_preview, s_tally_preview, s_tally_preview};
+    std::mutex m_receiver_statistics_mutex;
+    std::condition_variable_any m_receiver_statistics_condition;
+    std::jthread m_receiver_statistics_thread;
 
     void create_finder();
+    void restore_session();
+    void open_source_window(const NDIlib_source_t&);
+    void draw_source_browser();
+    void draw_tracing_menu();
+    void draw_routes_menu();
+    void wait_for_events();
+    void apply_present_mode();
+    void limit_frame_rate();
+    bool poll_source_windows();
+    void update_multiviewer();
+    void update_multiviewer_output();
+    void draw_multiviewer_output_menu();
+    void enter_fullscreen_output(std::string_view source_name, GLFWmonitor*);
+    void exit_fullscreen_output();
+    void render_fullscreen_output();
+    void present();
+    double frame_time_budget_fraction_used() const;
+    void update_automatic_bandwidth();
+    void update_tally();
+    void draw_statistics_window();
+    void sample_receiver_statistics(std::stop_token);
+    void export_receiver_statistics(
+        std::span<const std::pair<std::string, ReceiverStatistics::Snapshot>> receiver_statistics) const;
     bool initialize_playback_device(ma_device_info*);
     static void miniaudio_playback_data_callback(ma_device* device, void* output, const void*, ma_uint32 frame_count);
+
+    static void glfw_event_callback(GLFWwindow*);
+
+    static void* settings_read_open(ImGuiContext*, ImGuiSettingsHandler*, const char* name);
+    static void settings_read_line(ImGuiContext*, ImGuiSettingsHandler*, void* entry, const char* line);
+    static void settings_write_all(ImGuiContext*, ImGuiSettingsHandler*, ImGuiTextBuffer*);
 };
 }
\ No newline at end of file
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "Deinterlacer.h"
+#include <string_view>
+
+namespace Carousel
+{
+static constexpr std::string_view s_vertex_shader_source = R"(#version 330 core
+void main()
+{
+    // One triangle that covers the whole framebuffer.
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+// Rows of the output line up one to one with rows of the frame, so everything here is done with texelFetch().
+static constexpr std::string_view s_fragment_shader_source = R"(#version 330 core
+uniform sampler2D current_frame;
+uniform sampler2D previous_frame;
+// 1 is bob, 2 is motion adaptive.
+uniform int mode;
+uniform int field;
+
+out vec4 color;
+
+void main()
+{
+    ivec2 position = ivec2(gl_FragCoord.xy);
+    vec4 woven = texelFetch(current_frame, position, 0);
+
+    if ((position.y & 1) == field)
+    {
+        color = woven;
+        return;
+    }
+
+    int last_line = textureSize(current_frame, 0).y - 1;
+    vec4 above = texelFetch(current_frame, ivec2(position.x, max(position.y - 1, 0)), 0);
+    vec4 below = texelFetch(current_frame, ivec2(position.x, min(position.y + 1, last_line)), 0);
+    vec4 interpolated = (above + below) * 0.5;
+
+    if (mode != 2)
+    {
+        color = interpolated;
+        return;
+    }
+
+    // If this line hasn't changed since the last frame, nothing is moving here, so the other field's line is exactly
+    // what belongs here.
+    vec3 difference = abs(woven.rgb - texelFetch(previous_frame, position, 0).rgb);
+    float motion = max(difference.r, max(difference.g, difference.b));
+    color = mix(woven, interpolated, smoothstep(0.02, 0.08, motion));
+}
+)";
+
+Deinterlacer::Deinterlacer() : m_program(s_vertex_shader_source, s_fragment_shader_source)
+{
+    m_mode_uniform_location = m_program.uniform_location("mode");
+    m_field_uniform_location = m_program.uniform_location("field");
+
+    glUseProgram(m_program.name());
+    glUniform1i(m_program.uniform_location("current_frame"), 0);
+    glUniform1i(m_program.uniform_location("previous_frame"), 1);
+    glUseProgram(0);
+
+    glGenVertexArrays(1, &m_vertex_array);
+    glGenFramebuffers(1, &m_framebuffer);
+
+    glGenTextures(static_cast<GLsizei>(m_frame_textures.size()), m_frame_textures.data());
+    for (auto frame_texture : m_frame_textures)
+    {
+        glBindTexture(GL_TEXTURE_2D, frame_texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+Deinterlacer::~Deinterlacer()
+{
+    glDeleteTextures(static_cast<GLsizei>(m_frame_textures.size()), m_frame_textures.data());
+    glDeleteFramebuffers(1, &m_framebuffer);
+    glDeleteVertexArrays(1, &m_vertex_array);
+}
+
+void Deinterlacer::upload(int width, int height, const void* data)
+{
+    m_current_frame_index ^= 1;
+
+    // After a change in size, the previous frame is meaningless, so give it the new frame too. That way the first
+    // frame at a new size is treated as having no motion at all.
+    auto has_size_changed = width != m_width || height != m_height;
+    m_width = width;
+    m_height = height;
+
+    // Storage is only made when the size changes. Otherwise we write over the older frame in place, rather than have
+    // the driver make new storage for it every frame.
+    for (auto i = 0; i < static_cast<int>(m_frame_textures.size()); i++)
+    {
+        glBindTexture(GL_TEXTURE_2D, m_frame_textures[i]);
+
+        if (has_size_changed)
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        else if (i == m_current_frame_index)
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Deinterlacer::render(GLuint output, Mode mode, int field)
+{
+    if (m_width <= 0 || m_height <= 0)
+        return;
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    auto was_blend_enabled = glIsEnabled(GL_BLEND);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, output, 0);
+    glViewport(0, 0, m_width, m_height);
+
+    glDisable(GL_BLEND);
+    glUseProgram(m_program.name());
+    glUniform1i(m_mode_uniform_location, static_cast<int>(mode));
+    glUniform1i(m_field_uniform_location, field);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_frame_textures[m_current_frame_index ^ 1]);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_frame_textures[m_current_frame_index]);
+
+    glBindVertexArray(m_vertex_array);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    if (was_blend_enabled)
+        glEnable(GL_BLEND);
+}
+}
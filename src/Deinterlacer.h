@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include "ShaderProgram.h"
+#include <array>
+#include <glad/gl.h>
+
+namespace Carousel
+{
+// Turns interleaved frames (both fields woven together, even lines being field 0) into progressive ones on the GPU.
+// Each frame is shown as two fields, one after the other, so motion is as smooth as it was when it was captured.
+//
+// This is its own pass into the source's frame texture, rather than part of a display shader, as that texture is shown
+// through ImGui, the multiviewer and the fullscreen output alike, and each would otherwise need to deinterlace itself.
+class Deinterlacer
+{
+public:
+    enum class Mode
+    {
+        // Show the frame as it is, combing and all.
+        Weave,
+        // Only show the lines of the current field, interpolating the ones between them.
+        Bob,
+        // Weave where nothing is moving, and bob where it is.
+        MotionAdaptive,
+    };
+
+    Deinterlacer();
+    ~Deinterlacer();
+
+    Deinterlacer(const Deinterlacer&) = delete;
+
+    // Takes a new interleaved RGBA frame. The previous one is kept around for motion detection.
+    void upload(int width, int height, const void* data);
+    // Renders one field of the last uploaded frame into output, which must be an RGBA texture of the same size.
+    void render(GLuint output, Mode, int field);
+
+private:
+    ShaderProgram m_program;
+    GLuint m_vertex_array{};
+    GLuint m_framebuffer{};
+    // The current frame, and the one before it.
+    std::array<GLuint, 2> m_frame_textures{};
+    int m_current_frame_index{};
+    int m_width{};
+    int m_height{};
+    GLint m_mode_uniform_location{};
+    GLint m_field_uniform_location{};
+};
+}
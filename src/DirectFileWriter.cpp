@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "DirectFileWriter.h"
+#include <JMP/ScopeGuard.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+namespace Carousel
+{
+DirectFileWriter::DirectFileWriter(const std::filesystem::path& path, size_t chunk_size, size_t number_of_chunks)
+    : m_path(path), m_chunk_size(chunk_size)
+{
+    auto flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+    m_file_descriptor = open(path.c_str(), flags | O_DIRECT, 0644);
+    // Some filesystems (tmpfs, for one) don't do direct I/O, but they'll still take regular writes.
+    if (m_file_descriptor == -1 && errno == EINVAL)
+        m_file_descriptor = open(path.c_str(), flags, 0644);
+#else
+    m_file_descriptor = open(path.c_str(), flags, 0644);
+#endif
+
+    if (m_file_descriptor == -1)
+        throw std::runtime_error("Failed to create " + path.string() + ": " + strerror(errno));
+
+    JMP::ScopeGuard close_if_error_occurs = [this]() { close(m_file_descriptor); };
+
+    m_free_chunks.reserve(number_of_chunks);
+    for (size_t i = 0; i < number_of_chunks; i++)
+    {
+        m_free_chunks.emplace_back(
+            static_cast<std::byte*>(::operator new[](chunk_size, std::align_val_t{s_alignment})));
+    }
+
+    close_if_error_occurs.disarm();
+}
+
+DirectFileWriter::~DirectFileWriter()
+{
+    if (m_file_descriptor != -1)
+        close(m_file_descriptor);
+}
+
+std::optional<uint64_t> DirectFileWriter::append(const void* data, size_t size)
+{
+    std::lock_guard lock(m_mutex);
+
+    auto room = m_free_chunks.size() * m_chunk_size;
+    if (m_current_chunk)
+        room += m_chunk_size - m_current_chunk_size;
+
+    if (size > room)
+        return {};
+
+    auto offset = m_appended_size;
+    auto* bytes = static_cast<const std::byte*>(data);
+
+    while (size > 0)
+    {
+        if (!m_current_chunk)
+        {
+            m_current_chunk = std::move(m_free_chunks.back());
+            m_free_chunks.pop_back();
+            m_current_chunk_size = 0;
+        }
+
+        auto size_to_copy = std::min(size, m_chunk_size - m_current_chunk_size);
+        memcpy(m_current_chunk.get() + m_current_chunk_size, bytes, size_to_copy);
+        m_current_chunk_size += size_to_copy;
+        m_appended_size += size_to_copy;
+        bytes += size_to_copy;
+        size -= size_to_copy;
+
+        if (m_current_chunk_size == m_chunk_size)
+            m_full_chunks.push_back(std::move(m_current_chunk));
+    }
+
+    return offset;
+}
+
+bool DirectFileWriter::write_full_chunks()
+{
+    auto has_written = false;
+
+    while (true)
+    {
+        Chunk chunk;
+
+        {
+            std::lock_guard lock(m_mutex);
+            if (m_full_chunks.empty())
+                break;
+
+            chunk = std::move(m_full_chunks.front());
+            m_full_chunks.pop_front();
+        }
+
+        // The disk is the slow part, so the producer can keep appending whilst we're here.
+        write(chunk.get(), m_chunk_size);
+        has_written = true;
+
+        std::lock_guard lock(m_mutex);
+        m_free_chunks.push_back(std::move(chunk));
+    }
+
+    return has_written;
+}
+
+void DirectFileWriter::finish()
+{
+    write_full_chunks();
+
+    std::lock_guard lock(m_mutex);
+
+    if (m_current_chunk && m_current_chunk_size > 0)
+    {
+        // The last write has to be aligned too, so pad it out, and trim the padding off afterwards.
+        auto padded_size = (m_current_chunk_size + s_alignment - 1) / s_alignment * s_alignment;
+        memset(m_current_chunk.get() + m_current_chunk_size, 0, padded_size - m_current_chunk_size);
+        write(m_current_chunk.get(), padded_size);
+    }
+
+    if (ftruncate(m_file_descriptor, static_cast<off_t>(m_appended_size)) == -1)
+        fprintf(stderr, "Failed to trim %s: %s\n", m_path.c_str(), strerror(errno));
+}
+
+void DirectFileWriter::write(const std::byte* data, size_t size)
+{
+    // Once something has gone wrong, the offsets in the file no longer match what we've handed out, so stop writing.
+    if (m_has_failed)
+        return;
+
+    while (size > 0)
+    {
+        auto written = pwrite(m_file_descriptor, data, size, static_cast<off_t>(m_file_offset));
+        if (written == -1 && errno == EINTR)
+            continue;
+
+        if (written <= 0)
+        {
+            fprintf(stderr, "Failed to write to %s: %s\n", m_path.c_str(), strerror(errno));
+            m_has_failed = true;
+            return;
+        }
+
+        data += written;
+        size -= static_cast<size_t>(written);
+        m_file_offset += static_cast<uint64_t>(written);
+        m_number_of_bytes_written += static_cast<uint64_t>(written);
+    }
+}
+}
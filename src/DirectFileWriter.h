@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <vector>
+
+namespace Carousel
+{
+// Streams to a file in large, aligned chunks, bypassing the page cache (O_DIRECT) where the platform has it. Whoever
+// produces the data appends it into preallocated chunks, and a single writer thread writes out the ones that fill up,
+// so the producer never waits on the disk.
+class DirectFileWriter
+{
+public:
+    // O_DIRECT wants the buffer, size and file offset of every write aligned to the device's block size. This covers
+    // every device we're likely to see.
+    static constexpr size_t s_alignment = 4096;
+
+    // chunk_size must be a multiple of s_alignment. All chunk_size * number_of_chunks bytes are allocated up front.
+    DirectFileWriter(const std::filesystem::path&, size_t chunk_size, size_t number_of_chunks);
+    ~DirectFileWriter();
+
+    DirectFileWriter(const DirectFileWriter&) = delete;
+
+    // Copies the data onto the end of the file, returning the offset it will be at. If the disk has fallen so far
+    // behind that there isn't room to buffer all of it, nothing is copied and this returns nothing.
+    std::optional<uint64_t> append(const void* data, size_t size);
+
+    // These two are for the writer thread only. write_full_chunks() returns false if there was nothing to write.
+    bool write_full_chunks();
+    // Writes out whatever is left and trims the padding off the end of the file. Nothing may be appended after this.
+    void finish();
+
+    uint64_t number_of_bytes_written() const { return m_number_of_bytes_written; }
+    bool has_failed() const { return m_has_failed; }
+
+private:
+    struct AlignedDeleter
+    {
+        void operator()(std::byte* chunk) const { ::operator delete[](chunk, std::align_val_t{s_alignment}); }
+    };
+
+    using Chunk = std::unique_ptr<std::byte[], AlignedDeleter>;
+
+    std::filesystem::path m_path;
+    int m_file_descriptor = -1;
+    size_t m_chunk_size;
+    std::mutex m_mutex;
+    std::vector<Chunk> m_free_chunks;
+    std::deque<Chunk> m_full_chunks;
+    // Null until something is appended after the last one filled up.
+    Chunk m_current_chunk;
+    size_t m_current_chunk_size{};
+    uint64_t m_appended_size{};
+    // Only touched by the writer thread.
+    uint64_t m_file_offset{};
+    std::atomic<uint64_t> m_number_of_bytes_written{};
+    std::atomic<bool> m_has_failed{};
+
+    void write(const std::byte* data, size_t size);
+};
+}
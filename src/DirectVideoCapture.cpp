@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "DirectVideoCapture.h"
+#include "Tracer.h"
+
+namespace Carousel
+{
+DirectVideoCapture::DirectVideoCapture(NDIlib_recv_instance_t receiver_instance, std::function<void()> frame_captured)
+    : m_receiver_instance(receiver_instance), m_frame_captured(std::move(frame_captured)),
+      m_thread([this](std::stop_token stop_token) { run(stop_token); })
+{
+}
+
+DirectVideoCapture::~DirectVideoCapture()
+{
+    m_thread.request_stop();
+    m_thread.join();
+
+    for (auto& frame : m_frames)
+        NDIlib_recv_free_video_v2(m_receiver_instance, &frame.video_frame);
+}
+
+std::optional<DirectVideoCapture::Frame> DirectVideoCapture::take(int jitter_buffer_frames)
+{
+    std::lock_guard lock(m_mutex);
+
+    auto frames_to_keep = static_cast<size_t>(jitter_buffer_frames) + 1;
+    while (m_frames.size() > frames_to_keep)
+        drop_oldest_frame();
+
+    if (m_frames.size() < frames_to_keep)
+        return {};
+
+    auto frame = m_frames.front();
+    m_frames.pop_front();
+    return frame;
+}
+
+void DirectVideoCapture::free(Frame& frame) { NDIlib_recv_free_video_v2(m_receiver_instance, &frame.video_frame); }
+
+uint64_t DirectVideoCapture::number_of_dropped_frames() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_number_of_dropped_frames;
+}
+
+void DirectVideoCapture::run(std::stop_token stop_token)
+{
+    Tracer::set_thread_name("Direct video capture");
+
+    while (!stop_token.stop_requested())
+    {
+        Frame frame;
+
+        // We only ever ask for video. Audio and metadata are left queued in the receiver, where NDI will discard them
+        // as they get too old.
+        if (NDIlib_recv_capture_v3(m_receiver_instance, &frame.video_frame, nullptr, nullptr,
+                                   s_capture_timeout_milliseconds) != NDIlib_frame_type_video)
+            continue;
+
+        // Only what we do with the frame, not the time spent waiting for it.
+        TraceScope trace_scope("Queue captured frame");
+        frame.captured_at = std::chrono::steady_clock::now();
+
+        {
+            std::lock_guard lock(m_mutex);
+            m_frames.push_back(frame);
+
+            if (m_frames.size() > s_maximum_queued_frames)
+                drop_oldest_frame();
+        }
+
+        if (m_frame_captured)
+            m_frame_captured();
+    }
+}
+
+void DirectVideoCapture::drop_oldest_frame()
+{
+    NDIlib_recv_free_video_v2(m_receiver_instance, &m_frames.front().video_frame);
+    m_frames.pop_front();
+    m_number_of_dropped_frames++;
+}
+}
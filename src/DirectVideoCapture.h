@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include "NDI.h"
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace Carousel
+{
+// Captures video straight from a receiver on its own thread, without a framesync in the way. Frames are queued as NDI
+// gave them to us (no copies), and the render thread decides how many to keep back as a jitter buffer.
+class DirectVideoCapture
+{
+public:
+    struct Frame
+    {
+        NDIlib_video_frame_v2_t video_frame{};
+        std::chrono::steady_clock::time_point captured_at;
+    };
+
+    // frame_captured is called from the capture thread every time a frame is queued.
+    DirectVideoCapture(NDIlib_recv_instance_t, std::function<void()> frame_captured);
+    ~DirectVideoCapture();
+
+    DirectVideoCapture(const DirectVideoCapture&) = delete;
+
+    // Takes the oldest frame, but only once there are more than jitter_buffer_frames queued behind it. Anything older
+    // than that is dropped, so we never fall further behind than the jitter buffer allows. Frames that are taken must
+    // be given back to free().
+    std::optional<Frame> take(int jitter_buffer_frames);
+    void free(Frame&);
+
+    uint64_t number_of_dropped_frames() const;
+
+private:
+    // If the render thread stops taking frames (e.g. the window is hidden), don't hold onto more than this.
+    static constexpr size_t s_maximum_queued_frames = 16;
+    static constexpr uint32_t s_capture_timeout_milliseconds = 100;
+
+    NDIlib_recv_instance_t m_receiver_instance;
+    std::function<void()> m_frame_captured;
+    mutable std::mutex m_mutex;
+    std::deque<Frame> m_frames;
+    uint64_t m_number_of_dropped_frames{};
+    // Declared last, so that it is joined before the queue goes away.
+    std::jthread m_thread;
+
+    void run(std::stop_token);
+    void drop_oldest_frame();
+};
+}
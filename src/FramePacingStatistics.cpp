@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "FramePacingStatistics.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Carousel
+{
+// NDI timecodes are in 100ns units.
+static constexpr double s_timecode_units_per_second = 10'000'000.0;
+
+void FramePacingStatistics::record_frame(std::chrono::steady_clock::time_point time, int64_t timecode,
+                                         int frame_rate_n, int frame_rate_d)
+{
+    m_number_of_frames++;
+
+    if (frame_rate_n > 0 && frame_rate_d > 0)
+        m_expected_interval_seconds = static_cast<double>(frame_rate_d) / static_cast<double>(frame_rate_n);
+
+    if (m_has_previous_frame && m_expected_interval_seconds > 0.0)
+    {
+        auto interval_seconds = std::chrono::duration<double>(time - m_previous_frame_time).count();
+        auto timecode_interval_seconds =
+            static_cast<double>(timecode - m_previous_frame_timecode) / s_timecode_units_per_second;
+
+        m_number_of_intervals++;
+        m_total_interval_seconds += interval_seconds;
+        m_maximum_interval_seconds = std::max(m_maximum_interval_seconds, interval_seconds);
+
+        auto bucket = static_cast<int>(interval_seconds / m_expected_interval_seconds / s_histogram_bucket_width);
+        m_interval_histogram[std::clamp(bucket, 0, s_number_of_histogram_buckets - 1)]++;
+
+        // How many frame intervals passed, both by our clock and by the sender's.
+        auto elapsed_frames = static_cast<int64_t>(std::llround(interval_seconds / m_expected_interval_seconds));
+        auto advanced_frames =
+            static_cast<int64_t>(std::llround(timecode_interval_seconds / m_expected_interval_seconds));
+
+        if (advanced_frames > 1)
+            m_number_of_skipped_frames += advanced_frames - 1;
+
+        if (elapsed_frames > advanced_frames && advanced_frames >= 1)
+            m_number_of_repeated_frames += elapsed_frames - advanced_frames;
+    }
+
+    m_has_previous_frame = true;
+    m_previous_frame_time = time;
+    m_previous_frame_timecode = timecode;
+}
+
+void FramePacingStatistics::reset()
+{
+    auto expected_interval_seconds = m_expected_interval_seconds;
+    *this = {};
+    m_expected_interval_seconds = expected_interval_seconds;
+}
+
+double FramePacingStatistics::average_interval_milliseconds() const
+{
+    if (m_number_of_intervals == 0)
+        return 0.0;
+
+    return m_total_interval_seconds / static_cast<double>(m_number_of_intervals) * 1000.0;
+}
+}
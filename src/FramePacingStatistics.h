@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace Carousel
+{
+// Tracks how evenly new frames from a source arrive, relative to the frame rate it advertises. Recording a frame never
+// allocates.
+//
+// A frame that arrives late but directly follows the last one (by timecode) means we showed the previous frame again
+// for a while, which points at the network or our own render loop. A gap in the timecodes means frames never reached
+// us at all, which points at the sender or the network.
+class FramePacingStatistics
+{
+public:
+    // Each bucket covers an eighth of the expected frame interval. The last bucket also counts anything longer.
+    static constexpr int s_number_of_histogram_buckets = 32;
+    static constexpr double s_histogram_bucket_width = 0.125;
+
+    void record_frame(std::chrono::steady_clock::time_point, int64_t timecode, int frame_rate_n, int frame_rate_d);
+    // The next frame doesn't follow on from the last one (e.g. we switched receivers), so don't measure between them.
+    void break_continuity() { m_has_previous_frame = false; }
+    void reset();
+
+    const std::array<uint32_t, s_number_of_histogram_buckets>& interval_histogram() const
+    {
+        return m_interval_histogram;
+    }
+
+    uint64_t number_of_frames() const { return m_number_of_frames; }
+    uint64_t number_of_repeated_frames() const { return m_number_of_repeated_frames; }
+    uint64_t number_of_skipped_frames() const { return m_number_of_skipped_frames; }
+    double expected_interval_milliseconds() const { return m_expected_interval_seconds * 1000.0; }
+    double average_interval_milliseconds() const;
+    double maximum_interval_milliseconds() const { return m_maximum_interval_seconds * 1000.0; }
+
+private:
+    std::array<uint32_t, s_number_of_histogram_buckets> m_interval_histogram{};
+    uint64_t m_number_of_frames{};
+    uint64_t m_number_of_intervals{};
+    uint64_t m_number_of_repeated_frames{};
+    uint64_t m_number_of_skipped_frames{};
+    double m_total_interval_seconds{};
+    double m_maximum_interval_seconds{};
+    double m_expected_interval_seconds{};
+
+    bool m_has_previous_frame{};
+    std::chrono::steady_clock::time_point m_previous_frame_time;
+    int64_t m_previous_frame_timecode{};
+};
+}
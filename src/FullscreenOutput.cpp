@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "FullscreenOutput.h"
+#include <string_view>
+
+namespace Carousel
+{
+static constexpr std::string_view s_vertex_shader_source = R"(#version 330 core
+uniform vec2 scale;
+
+out vec2 uv;
+
+void main()
+{
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    // Frames are uploaded top row first, so the top of the screen is the start of the texture.
+    uv = vec2(corner.x, 1.0 - corner.y);
+    gl_Position = vec4((corner * 2.0 - 1.0) * scale, 0.0, 1.0);
+}
+)";
+
+static constexpr std::string_view s_fragment_shader_source = R"(#version 330 core
+in vec2 uv;
+
+uniform sampler2D frame;
+
+out vec4 color;
+
+void main()
+{
+    color = vec4(texture(frame, uv).rgb, 1.0);
+}
+)";
+
+FullscreenOutput::FullscreenOutput() : m_program(s_vertex_shader_source, s_fragment_shader_source)
+{
+    m_scale_uniform_location = m_program.uniform_location("scale");
+
+    glUseProgram(m_program.name());
+    glUniform1i(m_program.uniform_location("frame"), 0);
+    glUseProgram(0);
+
+    // We have no vertex data, but a core profile context still requires a vertex array to be bound to draw.
+    glGenVertexArrays(1, &m_vertex_array);
+}
+
+FullscreenOutput::~FullscreenOutput() { glDeleteVertexArrays(1, &m_vertex_array); }
+
+void FullscreenOutput::render(GLuint texture, int frame_width, int frame_height, int framebuffer_width,
+                              int framebuffer_height) const
+{
+    if (frame_width <= 0 || frame_height <= 0 || framebuffer_width <= 0 || framebuffer_height <= 0)
+        return;
+
+    auto frame_aspect_ratio = static_cast<float>(frame_width) / static_cast<float>(frame_height);
+    auto framebuffer_aspect_ratio = static_cast<float>(framebuffer_width) / static_cast<float>(framebuffer_height);
+
+    float scale_x = 1.0f, scale_y = 1.0f;
+    if (frame_aspect_ratio > framebuffer_aspect_ratio)
+        scale_y = framebuffer_aspect_ratio / frame_aspect_ratio;
+    else
+        scale_x = frame_aspect_ratio / framebuffer_aspect_ratio;
+
+    glDisable(GL_BLEND);
+    glUseProgram(m_program.name());
+    glUniform2f(m_scale_uniform_location, scale_x, scale_y);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    glBindVertexArray(m_vertex_array);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+}
+}
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include "ShaderProgram.h"
+#include <glad/gl.h>
+
+namespace Carousel
+{
+// Draws a single frame straight to the default framebuffer with one quad, letterboxed to keep its aspect ratio. This
+// is the entire render path for the fullscreen output, there is no ImGui involved.
+class FullscreenOutput
+{
+public:
+    FullscreenOutput();
+    ~FullscreenOutput();
+
+    FullscreenOutput(const FullscreenOutput&) = delete;
+
+    void render(GLuint texture, int frame_width, int frame_height, int framebuffer_width,
+                int framebuffer_height) const;
+
+private:
+    ShaderProgram m_program;
+    GLuint m_vertex_array{};
+    GLint m_scale_uniform_location{};
+};
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "GPUTimer.h"
+
+namespace Carousel
+{
+GPUTimer::GPUTimer() { glGenQueries(s_number_of_queries, m_queries.data()); }
+
+GPUTimer::~GPUTimer() { glDeleteQueries(s_number_of_queries, m_queries.data()); }
+
+void GPUTimer::begin()
+{
+    collect_results();
+
+    // The GPU is still behind on our last use of this query. Rather than wait for it, skip this measurement.
+    if (m_is_query_pending[m_next_query_index])
+        return;
+
+    glBeginQuery(GL_TIME_ELAPSED, m_queries[m_next_query_index]);
+    m_is_measuring = true;
+}
+
+void GPUTimer::end()
+{
+    if (!m_is_measuring)
+        return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    m_is_measuring = false;
+    m_is_query_pending[m_next_query_index] = true;
+    m_next_query_index = (m_next_query_index + 1) % s_number_of_queries;
+}
+
+void GPUTimer::collect_results()
+{
+    // Oldest first, so the average sees results in the order they were measured.
+    for (auto i = 0; i < s_number_of_queries; i++)
+    {
+        auto query_index = (m_next_query_index + i) % s_number_of_queries;
+        if (!m_is_query_pending[query_index])
+            continue;
+
+        GLint is_result_available{};
+        glGetQueryObjectiv(m_queries[query_index], GL_QUERY_RESULT_AVAILABLE, &is_result_available);
+        if (!is_result_available)
+            break;
+
+        GLuint64 elapsed_nanoseconds{};
+        glGetQueryObjectui64v(m_queries[query_index], GL_QUERY_RESULT, &elapsed_nanoseconds);
+        m_is_query_pending[query_index] = false;
+
+        auto elapsed_milliseconds = static_cast<double>(elapsed_nanoseconds) / 1'000'000.0;
+
+        if (m_has_result)
+            m_average_milliseconds += (elapsed_milliseconds - m_average_milliseconds) * s_smoothing_factor;
+        else
+            m_average_milliseconds = elapsed_milliseconds;
+
+        m_has_result = true;
+    }
+}
+}
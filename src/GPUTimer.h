@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <array>
+#include <glad/gl.h>
+
+namespace Carousel
+{
+// Measures how long the GPU spends on the commands issued between begin() and end(). Results are read back a few
+// frames later, once the GPU has actually gotten around to them, so this never stalls waiting on the GPU.
+//
+// Only one GPUTimer may be between begin() and end() at a time, as GL_TIME_ELAPSED queries cannot be nested.
+class GPUTimer
+{
+public:
+    GPUTimer();
+    ~GPUTimer();
+
+    GPUTimer(const GPUTimer&) = delete;
+
+    void begin();
+    void end();
+
+    // Smoothed over recent measurements. Zero until the first result has been read back.
+    double average_milliseconds() const { return m_average_milliseconds; }
+
+private:
+    // Enough for results to come back before we need the query again, given a few frames of GPU latency.
+    static constexpr int s_number_of_queries = 4;
+    static constexpr double s_smoothing_factor = 0.1;
+
+    std::array<GLuint, s_number_of_queries> m_queries{};
+    std::array<bool, s_number_of_queries> m_is_query_pending{};
+    int m_next_query_index{};
+    bool m_is_measuring{};
+    bool m_has_result{};
+    double m_average_milliseconds{};
+
+    void collect_results();
+};
+}
@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "HeadlessMonitor.h"
+#include "PrometheusTextFile.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace Carousel
+{
+static volatile std::sig_atomic_t s_is_interrupted = 0;
+
+static void handle_interruption(int) { s_is_interrupted = 1; }
+
+HeadlessMonitor::HeadlessMonitor(const std::filesystem::path& configuration_path)
+{
+    read_configuration(configuration_path);
+
+    if (m_sources.empty())
+        throw std::runtime_error("No sources given in " + configuration_path.string());
+
+    for (auto& source : m_sources)
+    {
+        // NDI finds the source by its name by itself, so we don't need a finder.
+        NDIlib_source_t ndi_source(source->name.c_str());
+        // We never look at the video itself, so take it in the smaller format.
+        source->receiver = std::make_unique<NDIReceiver>(ndi_source, m_bandwidth, NDIlib_recv_color_format_UYVY_RGBA);
+    }
+}
+
+HeadlessMonitor::~HeadlessMonitor()
+{
+    // The workers use the receivers, so they have to stop first.
+    m_workers.clear();
+}
+
+int HeadlessMonitor::run()
+{
+    std::signal(SIGINT, handle_interruption);
+    std::signal(SIGTERM, handle_interruption);
+
+    auto number_of_workers =
+        std::clamp(std::thread::hardware_concurrency(), 1u,
+                   std::min(s_maximum_number_of_workers, static_cast<unsigned>(m_sources.size())));
+    for (auto i = 0u; i < number_of_workers; i++)
+    {
+        m_workers.emplace_back([this, i, number_of_workers](std::stop_token stop_token) {
+            poll_sources(stop_token, i, number_of_workers);
+        });
+    }
+
+    fprintf(stderr, "Watching %zu sources with %u workers\n", m_sources.size(), number_of_workers);
+
+    auto next_write_out_time = std::chrono::steady_clock::now() + m_interval;
+    while (!s_is_interrupted)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        if (std::chrono::steady_clock::now() < next_write_out_time)
+            continue;
+
+        write_out();
+        next_write_out_time += m_interval;
+    }
+
+    m_workers.clear();
+    return EXIT_SUCCESS;
+}
+
+void HeadlessMonitor::read_configuration(const std::filesystem::path& configuration_path)
+{
+    auto* file = fopen(configuration_path.c_str(), "r");
+    if (!file)
+        throw std::runtime_error("Failed to open " + configuration_path.string() + ": " + strerror(errno));
+
+    char line[1024];
+    while (fgets(line, sizeof(line), file))
+    {
+        // Comments run to the end of the line, and may follow a setting, so drop them and any space left before them.
+        auto length = strcspn(line, "#\r\n");
+        while (length > 0 && isspace(static_cast<unsigned char>(line[length - 1])))
+            length--;
+        line[length] = '\0';
+        int value{};
+
+        if (line[0] == '\0')
+            continue;
+        else if (strncmp(line, "source=", 7) == 0)
+            m_sources.emplace_back(std::make_unique<Source>())->name = line + 7;
+        else if (strcmp(line, "bandwidth=highest") == 0)
+            m_bandwidth = NDIlib_recv_bandwidth_highest;
+        else if (strcmp(line, "bandwidth=lowest") == 0)
+            m_bandwidth = NDIlib_recv_bandwidth_lowest;
+        else if (strcmp(line, "bandwidth=audio_only") == 0)
+            m_bandwidth = NDIlib_recv_bandwidth_audio_only;
+        else if (strcmp(line, "bandwidth=metadata_only") == 0)
+            m_bandwidth = NDIlib_recv_bandwidth_metadata_only;
+        else if (strncmp(line, "metrics=", 8) == 0)
+            m_metrics_path = line + 8;
+        else if (sscanf(line, "interval=%d", &value) == 1 && value > 0)
+            m_interval = std::chrono::seconds(value);
+        else
+            fprintf(stderr, "Ignoring unknown line in %s: %s\n", configuration_path.c_str(), line);
+    }
+
+    fclose(file);
+}
+
+void HeadlessMonitor::poll_sources(std::stop_token stop_token, unsigned first_source_index,
+                                   unsigned source_index_stride)
+{
+    // Only here so that we can sleep until stopped.
+    std::mutex mutex;
+    std::condition_variable_any condition;
+
+    while (!stop_token.stop_requested())
+    {
+        auto now = std::chrono::steady_clock::now();
+
+        for (auto i = static_cast<size_t>(first_source_index); i < m_sources.size(); i += source_index_stride)
+        {
+            poll_video(*m_sources[i], now);
+            poll_audio(*m_sources[i], now);
+        }
+
+        std::unique_lock lock(mutex);
+        condition.wait_until(lock, stop_token, now + s_poll_interval, []() { return false; });
+    }
+}
+
+void HeadlessMonitor::poll_video(Source& source, std::chrono::steady_clock::time_point now)
+{
+    if (!source.receiver->is_receiving_video())
+        return;
+
+    auto* framesync_instance = source.receiver->framesync_instance();
+    NDIlib_video_frame_v2_t video_frame{};
+    NDIlib_framesync_capture_video(framesync_instance, &video_frame, NDIlib_frame_format_type_progressive);
+
+    // Like the GUI, we see the same frame many times over, so only new timecodes count.
+    if (video_frame.p_data && video_frame.timecode != source.last_video_timecode)
+    {
+        std::lock_guard lock(source.mutex);
+        source.frame_pacing.record_frame(now, video_frame.timecode, video_frame.frame_rate_N,
+                                         video_frame.frame_rate_D);
+        source.last_video_timecode = video_frame.timecode;
+    }
+
+    NDIlib_framesync_free_video(framesync_instance, &video_frame);
+}
+
+void HeadlessMonitor::poll_audio(Source& source, std::chrono::steady_clock::time_point now)
+{
+    if (source.receiver->bandwidth() == NDIlib_recv_bandwidth_metadata_only ||
+        now - source.last_audio_capture_time < s_audio_capture_interval)
+        return;
+
+    auto elapsed = now - source.last_audio_capture_time;
+    auto is_first_capture = source.last_audio_capture_time == std::chrono::steady_clock::time_point{};
+    source.last_audio_capture_time = now;
+    if (is_first_capture)
+        return;
+
+    auto* framesync_instance = source.receiver->framesync_instance();
+
+    // Asking for nothing tells us what the source is sending, without taking any of it.
+    NDIlib_audio_frame_v2_t audio_format{};
+    NDIlib_framesync_capture_audio(framesync_instance, &audio_format, 0, 0, 0);
+    NDIlib_framesync_free_audio(framesync_instance, &audio_format);
+    if (audio_format.no_channels <= 0)
+        return;
+
+    // The framesync resamples to whatever we ask for, so asking for exactly the time that has passed keeps it from
+    // building up or running dry.
+    auto number_of_channels = std::min(audio_format.no_channels, s_maximum_audio_channels);
+    auto number_of_samples = static_cast<int>(
+        std::min(std::chrono::duration<double>(elapsed).count(), 1.0) * static_cast<double>(s_audio_sample_rate));
+
+    NDIlib_audio_frame_v2_t audio_frame{};
+    NDIlib_framesync_capture_audio(framesync_instance, &audio_frame, s_audio_sample_rate, number_of_channels,
+                                   number_of_samples);
+
+    std::array<float, s_maximum_audio_channels> peak_levels{};
+    for (auto channel = 0; channel < number_of_channels; channel++)
+    {
+        auto* samples = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(audio_frame.p_data) +
+                                                       channel * audio_frame.channel_stride_in_bytes);
+        for (auto i = 0; i < audio_frame.no_samples; i++)
+            peak_levels[channel] = std::max(peak_levels[channel], std::abs(samples[i]));
+    }
+
+    NDIlib_framesync_free_audio(framesync_instance, &audio_frame);
+
+    std::lock_guard lock(source.mutex);
+    source.number_of_audio_channels = number_of_channels;
+    for (auto channel = 0; channel < number_of_channels; channel++)
+        source.peak_levels[channel] = std::max(source.peak_levels[channel], peak_levels[channel]);
+}
+
+void HeadlessMonitor::write_out()
+{
+    struct Sample
+    {
+        FramePacingStatistics frame_pacing;
+        std::array<float, s_maximum_audio_channels> peak_levels_decibels{};
+        int number_of_audio_channels{};
+    };
+
+    std::vector<std::pair<std::string, ReceiverStatistics::Snapshot>> receiver_statistics;
+    std::vector<Sample> samples;
+
+    for (auto& source : m_sources)
+    {
+        source->receiver_statistics.sample(*source->receiver);
+        receiver_statistics.emplace_back(source->name, source->receiver_statistics.snapshot());
+
+        auto& sample = samples.emplace_back();
+        std::lock_guard lock(source->mutex);
+        sample.frame_pacing = source->frame_pacing;
+        sample.number_of_audio_channels = source->number_of_audio_channels;
+
+        for (auto channel = 0; channel < source->number_of_audio_channels; channel++)
+        {
+            auto peak_level = source->peak_levels[channel];
+            sample.peak_levels_decibels[channel] =
+                peak_level > 0.0f ? std::max(20.0f * std::log10(peak_level), s_silence_decibels) : s_silence_decibels;
+        }
+
+        // Peaks are since the last time we wrote them out.
+        source->peak_levels = {};
+    }
+
+    if (m_metrics_path.empty())
+    {
+        for (size_t i = 0; i < m_sources.size(); i++)
+        {
+            auto& [name, statistics] = receiver_statistics[i];
+            auto& sample = samples[i];
+
+            printf("%s: %llu frames, %.2f ms average interval (%.2f ms longest), %llu repeated, %llu skipped, %lld "
+                   "dropped by NDI, audio peaks",
+                   name.c_str(), static_cast<unsigned long long>(sample.frame_pacing.number_of_frames()),
+                   sample.frame_pacing.average_interval_milliseconds(),
+                   sample.frame_pacing.maximum_interval_milliseconds(),
+                   static_cast<unsigned long long>(sample.frame_pacing.number_of_repeated_frames()),
+                   static_cast<unsigned long long>(sample.frame_pacing.number_of_skipped_frames()),
+                   static_cast<long long>(statistics.dropped_video_frames));
+
+            for (auto channel = 0; channel < sample.number_of_audio_channels; channel++)
+                printf(" %.1f", sample.peak_levels_decibels[channel]);
+            printf(sample.number_of_audio_channels > 0 ? " dBFS\n" : " (none)\n");
+        }
+
+        fflush(stdout);
+        return;
+    }
+
+    PrometheusTextFile metrics;
+    ReceiverStatistics::add_metrics(metrics, receiver_statistics);
+
+    auto add_frame_pacing_metric = [&](const char* name, const char* type, const char* help,
+                                       double (*value)(const FramePacingStatistics&)) {
+        metrics.add_metric(name, type, help);
+        for (size_t i = 0; i < m_sources.size(); i++)
+            metrics.add_sample(m_sources[i]->name, value(samples[i].frame_pacing));
+    };
+
+    add_frame_pacing_metric("carousel_frames_total", "counter", "New video frames seen.",
+                            [](const FramePacingStatistics& s) { return static_cast<double>(s.number_of_frames()); });
+    add_frame_pacing_metric(
+        "carousel_frames_repeated_total", "counter", "Frame intervals where the previous frame was shown again.",
+        [](const FramePacingStatistics& s) { return static_cast<double>(s.number_of_repeated_frames()); });
+    add_frame_pacing_metric(
+        "carousel_frames_skipped_total", "counter", "Frames missing from the timecodes we saw.",
+        [](const FramePacingStatistics& s) { return static_cast<double>(s.number_of_skipped_frames()); });
+    add_frame_pacing_metric("carousel_frame_interval_average_milliseconds", "gauge",
+                            "Average time between new frames.",
+                            [](const FramePacingStatistics& s) { return s.average_interval_milliseconds(); });
+    add_frame_pacing_metric("carousel_frame_interval_maximum_milliseconds", "gauge",
+                            "Longest time between new frames.",
+                            [](const FramePacingStatistics& s) { return s.maximum_interval_milliseconds(); });
+
+    metrics.add_metric("carousel_audio_peak_dbfs", "gauge", "Loudest sample on each channel since the last write.");
+    for (size_t i = 0; i < m_sources.size(); i++)
+    {
+        for (auto channel = 0; channel < samples[i].number_of_audio_channels; channel++)
+            metrics.add_sample(m_sources[i]->name, channel, samples[i].peak_levels_decibels[channel]);
+    }
+
+    metrics.write(m_metrics_path);
+}
+}
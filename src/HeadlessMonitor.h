@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include "FramePacingStatistics.h"
+#include "NDI.h"
+#include "NDIReceiver.h"
+#include "ReceiverStatistics.h"
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Carousel
+{
+// Watches sources without any window, GL or audio device, for machines without a display. We receive through the same
+// receivers and framesyncs as the GUI, but never decode anything for showing, so a box can watch far more sources.
+//
+// The configuration is a text file of key=value lines. A # starts a comment running to the end of the line, even after
+// a setting, so names can't contain one:
+//   source=NAME       A source to watch, by its NDI name. Give as many as you like.
+//   bandwidth=NAME    highest (the default), lowest, audio_only or metadata_only.
+//   metrics=PATH      Write Prometheus metrics here. Without it, a summary of each source is logged to stdout instead.
+//   interval=SECONDS  How often to sample and write everything out. Defaults to 1.
+class HeadlessMonitor
+{
+public:
+    // Throws if the configuration can't be read or doesn't name any sources.
+    explicit HeadlessMonitor(const std::filesystem::path& configuration_path);
+    ~HeadlessMonitor();
+
+    HeadlessMonitor(const HeadlessMonitor&) = delete;
+
+    // Runs until we're interrupted (SIGINT or SIGTERM).
+    int run();
+
+private:
+    // Fast enough to see each frame of a 60 fps source come in, and to time it to within a third of a frame.
+    static constexpr std::chrono::milliseconds s_poll_interval{5};
+    // Audio is only measured, so it can be pulled in larger blocks.
+    static constexpr std::chrono::milliseconds s_audio_capture_interval{50};
+    static constexpr int s_audio_sample_rate = 48000;
+    static constexpr int s_maximum_audio_channels = 8;
+    static constexpr float s_silence_decibels = -100.0f;
+    // Each worker polls its share of the sources in turn, rather than having a thread per source.
+    static constexpr unsigned s_maximum_number_of_workers = 4;
+
+    struct Source
+    {
+        std::string name;
+        std::unique_ptr<NDIReceiver> receiver;
+        ReceiverStatistics receiver_statistics;
+        int64_t last_video_timecode = -1;
+        std::chrono::steady_clock::time_point last_audio_capture_time;
+
+        // Written by a worker, read when we write everything out.
+        std::mutex mutex;
+        FramePacingStatistics frame_pacing;
+        // The loudest sample on each channel since we last wrote everything out.
+        std::array<float, s_maximum_audio_channels> peak_levels{};
+        int number_of_audio_channels{};
+    };
+
+    std::vector<std::unique_ptr<Source>> m_sources;
+    NDIlib_recv_bandwidth_e m_bandwidth = NDIlib_recv_bandwidth_highest;
+    std::string m_metrics_path;
+    std::chrono::seconds m_interval{1};
+    std::vector<std::jthread> m_workers;
+
+    void read_configuration(const std::filesystem::path&);
+    void poll_sources(std::stop_token, unsigned first_source_index, unsigned source_index_stride);
+    void poll_video(Source&, std::chrono::steady_clock::time_point now);
+    void poll_audio(Source&, std::chrono::steady_clock::time_point now);
+    void write_out();
+};
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "MetadataRing.h"
+
+namespace Carousel
+{
+MetadataRing::MetadataRing(size_t capacity) : m_entries(capacity) {}
+
+void MetadataRing::push(const NDIlib_metadata_frame_t& metadata_frame)
+{
+    if (m_size == m_entries.size())
+        m_number_of_overwritten_entries++;
+    else
+        m_size++;
+
+    auto& entry = m_entries[m_next_index];
+    m_next_index = (m_next_index + 1) % m_entries.size();
+
+    // NDI says the length includes the null terminator, but may also be zero, in which case we have to measure it.
+    if (!metadata_frame.p_data)
+        entry.data.clear();
+    else if (metadata_frame.length > 0)
+        entry.data.assign(metadata_frame.p_data, metadata_frame.length - 1);
+    else
+        entry.data.assign(metadata_frame.p_data);
+
+    entry.timecode = metadata_frame.timecode;
+}
+
+void MetadataRing::clear()
+{
+    // The entries themselves are left alone, so their buffers can be reused.
+    m_next_index = 0;
+    m_size = 0;
+    m_number_of_overwritten_entries = 0;
+}
+
+const MetadataRing::Entry& MetadataRing::operator[](size_t index) const
+{
+    auto oldest_index = (m_next_index + m_entries.size() - m_size) % m_entries.size();
+    return m_entries[(oldest_index + index) % m_entries.size()];
+}
+}
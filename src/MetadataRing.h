@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include "NDI.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Carousel
+{
+// Keeps the last few metadata frames received from a source. Once full, the oldest entry is overwritten, and its
+// buffer reused, so a steady stream of metadata stops allocating once it has filled the ring.
+class MetadataRing
+{
+public:
+    struct Entry
+    {
+        std::string data;
+        int64_t timecode{};
+    };
+
+    explicit MetadataRing(size_t capacity);
+
+    void push(const NDIlib_metadata_frame_t&);
+    void clear();
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    // Zero is the oldest entry.
+    const Entry& operator[](size_t index) const;
+    // How many entries have been overwritten before anyone could look at them, since the last clear().
+    uint64_t number_of_overwritten_entries() const { return m_number_of_overwritten_entries; }
+
+private:
+    std::vector<Entry> m_entries;
+    size_t m_next_index{};
+    size_t m_size{};
+    uint64_t m_number_of_overwritten_entries{};
+};
+}
@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "Multiviewer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace Carousel
+{
+static constexpr std::string_view s_vertex_shader_source = R"(#version 330 core
+layout(location = 0) in vec4 tile_rect;
+layout(location = 1) in vec4 tile_border_color;
+layout(location = 2) in vec2 tile_layer_and_aspect_ratio;
+
+uniform vec2 viewport_size;
+
+out vec2 position_in_tile;
+flat out vec2 tile_size;
+flat out vec4 border_color;
+flat out float layer;
+flat out float aspect_ratio;
+
+void main()
+{
+    // A triangle strip of 4 vertices covering the tile, so we don't need any vertex data besides the instance data.
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec2 position = tile_rect.xy + corner * tile_rect.zw;
+
+    position_in_tile = corner * tile_rect.zw;
+    tile_size = tile_rect.zw;
+    border_color = tile_border_color;
+    layer = tile_layer_and_aspect_ratio.x;
+    aspect_ratio = tile_layer_and_aspect_ratio.y;
+
+    gl_Position = vec4(position.x / viewport_size.x * 2.0 - 1.0, 1.0 - position.y / viewport_size.y * 2.0, 0.0, 1.0);
+}
+)";
+
+static constexpr std::string_view s_fragment_shader_source = R"(#version 330 core
+in vec2 position_in_tile;
+flat in vec2 tile_size;
+flat in vec4 border_color;
+flat in float layer;
+flat in float aspect_ratio;
+
+uniform sampler2DArray tiles;
+uniform float border_thickness;
+
+out vec4 color;
+
+void main()
+{
+    if (any(lessThan(position_in_tile, vec2(border_thickness))) ||
+        any(greaterThan(position_in_tile, tile_size - border_thickness)))
+    {
+        color = border_color;
+        return;
+    }
+
+    // Fit the frame inside the border, keeping its aspect ratio.
+    vec2 inner_size = tile_size - 2.0 * border_thickness;
+    vec2 frame_size = inner_size;
+    if (aspect_ratio > inner_size.x / inner_size.y)
+        frame_size.y = inner_size.x / aspect_ratio;
+    else
+        frame_size.x = inner_size.y * aspect_ratio;
+
+    vec2 frame_uv = (position_in_tile - border_thickness - (inner_size - frame_size) * 0.5) / frame_size;
+
+    if (aspect_ratio <= 0.0 || any(lessThan(frame_uv, vec2(0.0))) || any(greaterThan(frame_uv, vec2(1.0))))
+        color = vec4(0.0, 0.0, 0.0, 1.0);
+    else
+        color = texture(tiles, vec3(frame_uv, layer));
+}
+)";
+
+Multiviewer::Multiviewer() : m_program(s_vertex_shader_source, s_fragment_shader_source)
+{
+    m_viewport_size_uniform_location = m_program.uniform_location("viewport_size");
+
+    glUseProgram(m_program.name());
+    glUniform1i(m_program.uniform_location("tiles"), 0);
+    glUniform1f(m_program.uniform_location("border_thickness"), s_tile_border_thickness);
+    glUseProgram(0);
+
+    glGenVertexArrays(1, &m_vertex_array);
+    glGenBuffers(1, &m_instance_buffer);
+
+    glBindVertexArray(m_vertex_array);
+    glBindBuffer(GL_ARRAY_BUFFER, m_instance_buffer);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(TileInstance),
+                          reinterpret_cast<void*>(offsetof(TileInstance, rect)));
+    glVertexAttribDivisor(0, 1);
+
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(TileInstance),
+                          reinterpret_cast<void*>(offsetof(TileInstance, border_color)));
+    glVertexAttribDivisor(1, 1);
+
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(TileInstance),
+                          reinterpret_cast<void*>(offsetof(TileInstance, layer)));
+    glVertexAttribDivisor(2, 1);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenTextures(1, &m_tile_texture_array);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_tile_texture_array);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    glGenFramebuffers(1, &m_read_framebuffer);
+    glGenFramebuffers(1, &m_draw_framebuffer);
+}
+
+Multiviewer::~Multiviewer()
+{
+    glDeleteFramebuffers(1, &m_draw_framebuffer);
+    glDeleteFramebuffers(1, &m_read_framebuffer);
+    glDeleteTextures(1, &m_tile_texture_array);
+    glDeleteBuffers(1, &m_instance_buffer);
+    glDeleteVertexArrays(1, &m_vertex_array);
+}
+
+void Multiviewer::set_tile_texture_height(int tile_texture_height)
+{
+    if (m_tile_texture_height == tile_texture_height)
+        return;
+
+    m_tile_texture_height = tile_texture_height;
+    // Forces the array texture to be reallocated at the new size next update.
+    m_layer_capacity = 0;
+    m_layers.clear();
+}
+
+std::optional<size_t> Multiviewer::update(std::span<const Tile> tiles, ImVec2 position, ImVec2 size)
+{
+    m_tile_instances.clear();
+
+    if (tiles.empty())
+        return {};
+
+    ensure_layer_capacity(static_cast<int>(tiles.size()));
+
+    auto columns = m_columns > 0 ? m_columns : static_cast<int>(std::ceil(std::sqrt(tiles.size())));
+    auto rows = static_cast<int>((tiles.size() + columns - 1) / columns);
+    auto tile_width = (size.x - s_tile_spacing * static_cast<float>(columns - 1)) / static_cast<float>(columns);
+    auto tile_height = (size.y - s_tile_spacing * static_cast<float>(rows - 1)) / static_cast<float>(rows);
+
+    auto& io = ImGui::GetIO();
+    auto* draw_list = ImGui::GetBackgroundDrawList();
+    std::optional<size_t> clicked_tile_index;
+
+    for (size_t i = 0; i < tiles.size(); i++)
+    {
+        auto& tile = tiles[i];
+        auto layer = static_cast<int>(i);
+
+        if (m_layers[layer].texture != tile.texture || m_layers[layer].frame_serial != tile.frame_serial)
+            copy_frame_to_layer(tile, layer);
+
+        auto column = static_cast<int>(i) % columns;
+        auto row = static_cast<int>(i) / columns;
+        ImVec2 tile_position(position.x + static_cast<float>(column) * (tile_width + s_tile_spacing),
+                             position.y + static_cast<float>(row) * (tile_height + s_tile_spacing));
+
+        auto& instance = m_tile_instances.emplace_back();
+        instance.rect[0] = tile_position.x;
+        instance.rect[1] = tile_position.y;
+        instance.rect[2] = tile_width;
+        instance.rect[3] = tile_height;
+        instance.border_color[0] = tile.border_color.x;
+        instance.border_color[1] = tile.border_color.y;
+        instance.border_color[2] = tile.border_color.z;
+        instance.border_color[3] = tile.border_color.w;
+        instance.layer = static_cast<float>(layer);
+        instance.aspect_ratio =
+            tile.height > 0 ? static_cast<float>(tile.width) / static_cast<float>(tile.height) : 0.0f;
+
+        ImVec2 label_position(tile_position.x + s_tile_border_thickness * 2,
+                              tile_position.y + s_tile_border_thickness * 2);
+        auto label_size = ImGui::CalcTextSize(tile.label.data(), tile.label.data() + tile.label.size());
+        draw_list->AddRectFilled(label_position,
+                                 ImVec2(label_position.x + label_size.x, label_position.y + label_size.y),
+                                 IM_COL32(0, 0, 0, 160));
+        draw_list->AddText(label_position, IM_COL32(255, 255, 255, 255), tile.label.data(),
+                           tile.label.data() + tile.label.size());
+
+        if (!io.WantCaptureMouse && ImGui::IsMouseClicked(ImGuiMouseButton_Left) &&
+            io.MousePos.x >= tile_position.x && io.MousePos.x < tile_position.x + tile_width &&
+            io.MousePos.y >= tile_position.y && io.MousePos.y < tile_position.y + tile_height)
+        {
+            clicked_tile_index = i;
+        }
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_instance_buffer);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(m_tile_instances.size() * sizeof(TileInstance)),
+                 m_tile_instances.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    return clicked_tile_index;
+}
+
+void Multiviewer::render(ImVec2 display_size) const
+{
+    if (m_tile_instances.empty())
+        return;
+
+    glDisable(GL_BLEND);
+    glUseProgram(m_program.name());
+    glUniform2f(m_viewport_size_uniform_location, display_size.x, display_size.y);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_tile_texture_array);
+
+    glBindVertexArray(m_vertex_array);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(m_tile_instances.size()));
+    glBindVertexArray(0);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glUseProgram(0);
+}
+
+void Multiviewer::ensure_layer_capacity(int number_of_layers)
+{
+    if (number_of_layers > m_layer_capacity)
+    {
+        m_layer_capacity = (number_of_layers + s_layer_capacity_increment - 1) / s_layer_capacity_increment *
+                           s_layer_capacity_increment;
+
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_tile_texture_array);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, tile_texture_width(), m_tile_texture_height, m_layer_capacity,
+                     0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        // Reallocating threw away everything that was in there.
+        m_layers.clear();
+    }
+
+    m_layers.resize(number_of_layers, Layer{0, 0});
+}
+
+void Multiviewer::copy_frame_to_layer(const Tile& tile, int layer)
+{
+    m_layers[layer] = {tile.texture, tile.frame_serial};
+
+    if (tile.width <= 0 || tile.height <= 0)
+        return;
+
+    // Scaling the frame down into its layer on the GPU, rather than sampling the full size frame every time we draw,
+    // keeps the cost of each tile the same no matter the resolution of its source.
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_read_framebuffer);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tile.texture, 0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_draw_framebuffer);
+    glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_tile_texture_array, 0, layer);
+
+    glBlitFramebuffer(0, 0, tile.width, tile.height, 0, 0, tile_texture_width(), m_tile_texture_height,
+                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+}
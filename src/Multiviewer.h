@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include "ShaderProgram.h"
+#include <cstdint>
+#include <glad/gl.h>
+#include <imgui/imgui.h>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace Carousel
+{
+// Draws many sources as a grid of tiles, without an ImGui window for each of them. Every tile's frame is scaled into a
+// layer of one array texture, so that all of them (and their borders) can be drawn with a single instanced draw call.
+class Multiviewer
+{
+public:
+    struct Tile
+    {
+        GLuint texture;
+        int width;
+        int height;
+        // Used to tell if the frame in the texture has changed since we last copied it.
+        uint64_t frame_serial;
+        std::string_view label;
+        ImVec4 border_color;
+    };
+
+    Multiviewer();
+    ~Multiviewer();
+
+    Multiviewer(const Multiviewer&) = delete;
+
+    // Zero columns will choose a number of columns that keeps the grid roughly square.
+    int columns() const { return m_columns; }
+    void set_columns(int columns) { m_columns = columns; }
+    int tile_texture_height() const { return m_tile_texture_height; }
+    void set_tile_texture_height(int);
+
+    // Must be called during the ImGui frame, as this draws the labels. Returns the index of the tile that was clicked,
+    // if any.
+    std::optional<size_t> update(std::span<const Tile>, ImVec2 position, ImVec2 size);
+    // Draws the tiles into the currently bound framebuffer, which should have been cleared beforehand. The display size
+    // is in the same coordinates as the position and size given to update().
+    void render(ImVec2 display_size) const;
+
+private:
+    struct TileInstance
+    {
+        float rect[4];
+        float border_color[4];
+        float layer;
+        float aspect_ratio;
+    };
+
+    // What is currently in each layer of the array texture, so we only copy frames that have changed.
+    struct Layer
+    {
+        GLuint texture;
+        uint64_t frame_serial;
+    };
+
+    static constexpr float s_tile_spacing = 2.0f;
+    static constexpr float s_tile_border_thickness = 3.0f;
+    static constexpr int s_layer_capacity_increment = 8;
+
+    ShaderProgram m_program;
+    GLuint m_vertex_array{};
+    GLuint m_instance_buffer{};
+    GLuint m_tile_texture_array{};
+    GLuint m_read_framebuffer{};
+    GLuint m_draw_framebuffer{};
+    GLint m_viewport_size_uniform_location{};
+    int m_columns{};
+    int m_tile_texture_height = 360;
+    int m_layer_capacity{};
+    std::vector<Layer> m_layers;
+    std::vector<TileInstance> m_tile_instances;
+
+    void ensure_layer_capacity(int);
+    void copy_frame_to_layer(const Tile&, int layer);
+    int tile_texture_width() const { return m_tile_texture_height * 16 / 9; }
+};
+}
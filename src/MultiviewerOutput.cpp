@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "MultiviewerOutput.h"
+#include "Tracer.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace Carousel
+{
+MultiviewerOutput::MultiviewerOutput(const std::string& name, int width, int height)
+    : m_name(name), m_width(width), m_height(height)
+{
+    // We decide when frames go out ourselves, and only ever send video.
+    NDIlib_send_create_t send_create(m_name.c_str(), nullptr, false, false);
+    if (!(m_send_instance = NDIlib_send_create(&send_create)))
+        throw std::runtime_error("Failed to create NDI sender");
+
+    glGenTextures(1, &m_texture);
+    glGenTextures(1, &m_flipped_texture);
+    for (auto texture : {m_texture, m_flipped_texture})
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0);
+    glGenFramebuffers(1, &m_flipped_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_flipped_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_flipped_texture, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    auto frame_size = static_cast<size_t>(m_width) * static_cast<size_t>(m_height) * 4;
+
+    for (auto& readback : m_readbacks)
+    {
+        glGenBuffers(1, &readback.pixel_buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixel_buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(frame_size), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    for (auto& send_buffer : m_send_buffers)
+        send_buffer = std::make_unique<uint8_t[]>(frame_size);
+
+    m_thread = std::jthread([this](std::stop_token stop_token) { run(stop_token); });
+}
+
+MultiviewerOutput::~MultiviewerOutput()
+{
+    // NDI has to be done with our buffers before they go away.
+    m_thread.request_stop();
+    m_thread.join();
+    NDIlib_send_destroy(m_send_instance);
+
+    // Deleting a mapped buffer unmaps it too.
+    for (auto& readback : m_readbacks)
+    {
+        if (readback.fence)
+            glDeleteSync(readback.fence);
+        glDeleteBuffers(1, &readback.pixel_buffer);
+    }
+
+    glDeleteFramebuffers(1, &m_flipped_framebuffer);
+    glDeleteFramebuffers(1, &m_framebuffer);
+    glDeleteTextures(1, &m_flipped_texture);
+    glDeleteTextures(1, &m_texture);
+}
+
+void MultiviewerOutput::update(const Multiviewer& multiviewer, ImVec2 display_size)
+{
+    TraceScope trace_scope("Multiviewer output");
+    unmap_copied_readbacks();
+    collect_finished_readbacks();
+
+    auto now = std::chrono::steady_clock::now();
+    if (now < m_next_frame_time)
+        return;
+
+    // If we've fallen more than a frame behind (e.g. whilst rendering on demand), start counting again from now rather
+    // than trying to catch up.
+    m_next_frame_time = std::max(m_next_frame_time + s_frame_interval, now);
+
+    // Drawing and reading back a frame nobody will see is a waste of the GPU.
+    if (number_of_connections() == 0)
+        return;
+
+    if (m_number_of_pending_readbacks == s_number_of_readbacks)
+    {
+        m_number_of_dropped_frames++;
+        return;
+    }
+
+    render(multiviewer, display_size);
+
+    auto& readback =
+        m_readbacks[(m_oldest_readback_index + m_number_of_pending_readbacks) % s_number_of_readbacks];
+    m_number_of_pending_readbacks++;
+
+    // With a pixel buffer bound, this only queues the copy, rather than waiting for it like it would into our memory.
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_flipped_framebuffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixel_buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+int MultiviewerOutput::number_of_connections() const { return NDIlib_send_get_no_connections(m_send_instance, 0); }
+
+std::chrono::steady_clock::time_point MultiviewerOutput::next_frame_time() const
+{
+    if (number_of_connections() == 0)
+        return std::chrono::steady_clock::time_point::max();
+
+    return m_next_frame_time;
+}
+
+void MultiviewerOutput::render(const Multiviewer& multiviewer, ImVec2 display_size)
+{
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLfloat clear_color[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clear_color);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glViewport(0, 0, m_width, m_height);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
+
+    // Keep the layout's aspect ratio, so the tiles look the same as they do on the display.
+    if (display_size.x > 0.0f && display_size.y > 0.0f)
+    {
+        auto scale =
+            std::min(static_cast<float>(m_width) / display_size.x, static_cast<float>(m_height) / display_size.y);
+        auto width = static_cast<int>(display_size.x * scale);
+        auto height = static_cast<int>(display_size.y * scale);
+        glViewport((m_width - width) / 2, (m_height - height) / 2, width, height);
+        multiviewer.render(display_size);
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_flipped_framebuffer);
+    glBlitFramebuffer(0, 0, m_width, m_height, 0, m_height, m_width, 0, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void MultiviewerOutput::unmap_copied_readbacks()
+{
+    // Readbacks are copied (or skipped) in the order they were mapped, so we can stop at the first that hasn't been.
+    while (m_number_of_pending_readbacks > 0)
+    {
+        auto& readback = m_readbacks[m_oldest_readback_index];
+        if (readback.fence)
+            break;
+
+        // One that failed to map has nothing to wait for.
+        if (readback.mapped_pixels)
+        {
+            {
+                std::lock_guard lock(m_mutex);
+                if (!readback.is_copied)
+                    break;
+                readback.is_copied = false;
+            }
+
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixel_buffer);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            readback.mapped_pixels = nullptr;
+        }
+
+        m_oldest_readback_index = (m_oldest_readback_index + 1) % s_number_of_readbacks;
+        m_number_of_pending_readbacks--;
+    }
+}
+
+void MultiviewerOutput::collect_finished_readbacks()
+{
+    auto frame_size = static_cast<size_t>(m_width) * static_cast<size_t>(m_height) * 4;
+
+    // Fences pass in the order they were made, so we can stop at the first that hasn't.
+    for (size_t i = 0; i < m_number_of_pending_readbacks; i++)
+    {
+        auto& readback = m_readbacks[(m_oldest_readback_index + i) % s_number_of_readbacks];
+        if (!readback.fence)
+            continue;
+
+        if (glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+            break;
+
+        glDeleteSync(readback.fence);
+        readback.fence = nullptr;
+
+        // Mapping doesn't copy anything, that's left to our thread.
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixel_buffer);
+        readback.mapped_pixels =
+            glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(frame_size), GL_MAP_READ_BIT);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        if (!readback.mapped_pixels)
+        {
+            m_number_of_dropped_frames++;
+            continue;
+        }
+
+        std::lock_guard lock(m_mutex);
+        // Only the newest frame is worth sending, so one that's still waiting is skipped.
+        if (m_queued_readback)
+        {
+            m_queued_readback->is_copied = true;
+            m_number_of_dropped_frames++;
+        }
+        m_queued_readback = &readback;
+        m_condition.notify_one();
+    }
+}
+
+void MultiviewerOutput::run(std::stop_token stop_token)
+{
+    Tracer::set_thread_name("Multiviewer output");
+
+    auto frame_size = static_cast<size_t>(m_width) * static_cast<size_t>(m_height) * 4;
+    // NDI keeps using the buffer given to an asynchronous send until the next send returns, so we alternate.
+    size_t send_buffer_index{};
+
+    while (true)
+    {
+        Readback* readback;
+
+        {
+            std::unique_lock lock(m_mutex);
+            if (!m_condition.wait(lock, stop_token, [this]() { return m_queued_readback != nullptr; }))
+                break;
+
+            readback = std::exchange(m_queued_readback, nullptr);
+        }
+
+        TraceScope trace_scope("Send multiviewer frame");
+
+        // The mapping stays put until we say we're done with it, and it's only memory, so there's no GL involved.
+        auto* buffer = m_send_buffers[send_buffer_index].get();
+        send_buffer_index = (send_buffer_index + 1) % s_number_of_send_buffers;
+        memcpy(buffer, readback->mapped_pixels, frame_size);
+
+        {
+            std::lock_guard lock(m_mutex);
+            readback->is_copied = true;
+        }
+
+        NDIlib_video_frame_v2_t video_frame{};
+        video_frame.xres = m_width;
+        video_frame.yres = m_height;
+        video_frame.FourCC = NDIlib_FourCC_video_type_RGBX;
+        video_frame.frame_rate_N = s_frame_rate_N;
+        video_frame.frame_rate_D = s_frame_rate_D;
+        video_frame.frame_format_type = NDIlib_frame_format_type_progressive;
+        video_frame.timecode = NDIlib_send_timecode_synthesize;
+        video_frame.p_data = buffer;
+        video_frame.line_stride_in_bytes = m_width * 4;
+        NDIlib_send_send_video_async_v2(m_send_instance, &video_frame);
+        m_number_of_sent_frames++;
+    }
+
+    // Waits for the last frame to be done with.
+    NDIlib_send_send_video_async_v2(m_send_instance, nullptr);
+}
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include "Multiviewer.h"
+#include "NDI.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <glad/gl.h>
+#include <imgui/imgui.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Carousel
+{
+// Sends what the multiviewer draws as an NDI source of its own, so it can be watched somewhere else.
+//
+// Nothing here waits on the GPU or on NDI: the multiviewer is drawn into our own framebuffer, read back into a pixel
+// buffer behind a fence, and only mapped once the fence has passed on a later frame. Our own thread copies out of the
+// mapping and sends asynchronously, and we unmap it once it's done. If either falls behind, frames are dropped rather
+// than holding up the display.
+class MultiviewerOutput
+{
+public:
+    MultiviewerOutput(const std::string& name, int width, int height);
+    ~MultiviewerOutput();
+
+    MultiviewerOutput(const MultiviewerOutput&) = delete;
+
+    // Called every frame, after the multiviewer has been updated. Draws the next frame to send if it's time for one,
+    // and passes on any earlier frames that have finished reading back. The display size is the one given to
+    // Multiviewer::render(), and is letterboxed into our own size.
+    void update(const Multiviewer&, ImVec2 display_size);
+
+    const std::string& name() const { return m_name; }
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    int number_of_connections() const;
+    // When update() next wants to draw a frame, or never if nobody is watching. Rendering on demand has to wake up for
+    // these, as the display may have nothing new to draw.
+    std::chrono::steady_clock::time_point next_frame_time() const;
+    uint64_t number_of_sent_frames() const { return m_number_of_sent_frames; }
+    uint64_t number_of_dropped_frames() const { return m_number_of_dropped_frames; }
+
+private:
+    static constexpr int s_frame_rate_N = 30;
+    static constexpr int s_frame_rate_D = 1;
+    static constexpr std::chrono::steady_clock::duration s_frame_interval =
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(
+            static_cast<double>(s_frame_rate_D) / static_cast<double>(s_frame_rate_N)));
+    // The GPU usually finishes a readback within a frame or two, so a third lets it run a little late without us
+    // dropping anything.
+    static constexpr size_t s_number_of_readbacks = 3;
+    // One is owned by NDI whilst it is being sent, and the other is being copied into.
+    static constexpr size_t s_number_of_send_buffers = 2;
+
+    struct Readback
+    {
+        GLuint pixel_buffer{};
+        // Set whilst the GPU may still be writing to the pixel buffer.
+        GLsync fence{};
+        // Set whilst the pixel buffer is mapped, for our thread to copy out of.
+        const void* mapped_pixels{};
+        // Guarded by m_mutex. Set by our thread once it's done with the mapping, so it can be unmapped.
+        bool is_copied{};
+    };
+
+    std::string m_name;
+    int m_width{};
+    int m_height{};
+    NDIlib_send_instance_t m_send_instance{};
+    GLuint m_texture{};
+    GLuint m_framebuffer{};
+    // GL reads rows back bottom up, but NDI wants them top down, so we flip into this on the GPU first.
+    GLuint m_flipped_texture{};
+    GLuint m_flipped_framebuffer{};
+    // Readbacks in use, from the oldest: first those that are mapped, then those the GPU may still be writing to.
+    std::array<Readback, s_number_of_readbacks> m_readbacks;
+    size_t m_oldest_readback_index{};
+    size_t m_number_of_pending_readbacks{};
+    std::chrono::steady_clock::time_point m_next_frame_time;
+    // Only used by our thread.
+    std::array<std::unique_ptr<uint8_t[]>, s_number_of_send_buffers> m_send_buffers;
+    std::mutex m_mutex;
+    std::condition_variable_any m_condition;
+    // Guarded by m_mutex. The mapped readback waiting to be copied out and sent.
+    Readback* m_queued_readback{};
+    std::atomic<uint64_t> m_number_of_sent_frames{};
+    std::atomic<uint64_t> m_number_of_dropped_frames{};
+    // Declared last, so that it is joined before anything it uses goes away.
+    std::jthread m_thread;
+
+    void render(const Multiviewer&, ImVec2 display_size);
+    void unmap_copied_readbacks();
+    void collect_finished_readbacks();
+    void run(std::stop_token);
+};
+}
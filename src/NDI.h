@@ -13,3 +13,16 @@
 #include <cstddef>
 
 #include <NDI/Processing.NDI.Lib.h>
+
+namespace Carousel
+{
+// How many bytes a video frame's data takes. We only ever ask NDI for packed formats, where this is just one plane of
+// lines, apart from UYVA, which has its alpha plane after that.
+inline size_t video_frame_data_size(const NDIlib_video_frame_v2_t& video_frame)
+{
+    auto size = static_cast<size_t>(video_frame.line_stride_in_bytes) * static_cast<size_t>(video_frame.yres);
+    if (video_frame.FourCC == NDIlib_FourCC_video_type_UYVA)
+        size += static_cast<size_t>(video_frame.xres) * static_cast<size_t>(video_frame.yres);
+    return size;
+}
+}
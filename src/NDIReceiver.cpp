@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "NDIReceiver.h"
+#include <JMP/ScopeGuard.h>
+#include <stdexcept>
+
+namespace Carousel
+{
+NDIReceiver::NDIReceiver(const NDIlib_source_t& source, NDIlib_recv_bandwidth_e bandwidth,
+                         NDIlib_recv_color_format_e color_format, ReceiveMode receive_mode, bool allow_video_fields,
+                         std::function<void()> frame_captured)
+    : m_bandwidth(bandwidth), m_receive_mode(receive_mode), m_allows_video_fields(allow_video_fields)
+{
+    JMP::ScopeGuard free_if_error_occurs = [this]() { destroy(); };
+
+    NDIlib_recv_create_v3_t receiver_create{};
+    receiver_create.color_format = color_format;
+    receiver_create.bandwidth = bandwidth;
+    receiver_create.allow_video_fields = allow_video_fields;
+    receiver_create.source_to_connect_to = source;
+
+    if (!(m_receiver_instance = NDIlib_recv_create_v3(&receiver_create)))
+        throw std::runtime_error("Failed to create NDI receiver instance");
+
+    if (receive_mode == ReceiveMode::Direct)
+        m_direct_video_capture = std::make_unique<DirectVideoCapture>(m_receiver_instance, std::move(frame_captured));
+    else if (!(m_framesync_instance = NDIlib_framesync_create(m_receiver_instance)))
+        throw std::runtime_error("Failed to create NDI framesync instance");
+
+    free_if_error_occurs.disarm();
+}
+
+NDIReceiver::~NDIReceiver() { destroy(); }
+
+PTZController& NDIReceiver::ptz_controller()
+{
+    if (!m_ptz_controller)
+        m_ptz_controller = std::make_unique<PTZController>(m_receiver_instance);
+
+    return *m_ptz_controller;
+}
+
+void NDIReceiver::destroy()
+{
+    // Its thread still sends one last command through the receiver as it stops.
+    m_ptz_controller.reset();
+    // This frees the frames it still has queued, which needs the receiver.
+    m_direct_video_capture.reset();
+
+    // NDI says: You should always destroy the receiver after the frame-sync has been destroyed.
+    if (m_framesync_instance)
+    {
+        NDIlib_framesync_destroy(m_framesync_instance);
+        m_framesync_instance = nullptr;
+    }
+
+    if (m_receiver_instance)
+    {
+        NDIlib_recv_destroy(m_receiver_instance);
+        m_receiver_instance = nullptr;
+    }
+}
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include "DirectVideoCapture.h"
+#include "NDI.h"
+#include "PTZController.h"
+#include <functional>
+#include <memory>
+
+namespace Carousel
+{
+// Owns an NDI receiver and whatever we capture from it with: either a framesync, or a thread capturing video directly.
+// This holds no GL state, so it is safe to create and destroy on any thread.
+class NDIReceiver
+{
+public:
+    enum class ReceiveMode
+    {
+        // Video and audio are time-base corrected by a framesync. Smooth, but adds latency.
+        Framesync,
+        // Video is captured as soon as it arrives, see DirectVideoCapture. There is no audio in this mode.
+        Direct,
+    };
+
+    // With allow_video_fields, interlaced video is left for us to deinterlace, rather than the SDK doing it on the CPU.
+    // frame_captured is only used in direct mode, see DirectVideoCapture.
+    NDIReceiver(const NDIlib_source_t&, NDIlib_recv_bandwidth_e, NDIlib_recv_color_format_e,
+                ReceiveMode = ReceiveMode::Framesync, bool allow_video_fields = false,
+                std::function<void()> frame_captured = {});
+    ~NDIReceiver();
+
+    NDIReceiver(const NDIReceiver&) = delete;
+
+    NDIlib_recv_instance_t receiver_instance() const { return m_receiver_instance; }
+    // Null in direct mode.
+    NDIlib_framesync_instance_t framesync_instance() const { return m_framesync_instance; }
+    // Null in framesync mode.
+    DirectVideoCapture* direct_video_capture() const { return m_direct_video_capture.get(); }
+    NDIlib_recv_bandwidth_e bandwidth() const { return m_bandwidth; }
+    ReceiveMode receive_mode() const { return m_receive_mode; }
+    bool allows_video_fields() const { return m_allows_video_fields; }
+    // The audio only and metadata only bandwidths don't send any video at all.
+    bool is_receiving_video() const
+    {
+        return m_bandwidth != NDIlib_recv_bandwidth_audio_only && m_bandwidth != NDIlib_recv_bandwidth_metadata_only;
+    }
+    // The sender only tells us this once we're connected, so it can start out false.
+    bool is_ptz_supported() const { return NDIlib_recv_ptz_is_supported(m_receiver_instance); }
+    // Created the first time it's asked for, so receivers that nobody steers don't have a PTZ thread sitting around.
+    // Only ask for this once is_ptz_supported() is true.
+    PTZController& ptz_controller();
+
+private:
+    NDIlib_recv_instance_t m_receiver_instance{};
+    NDIlib_framesync_instance_t m_framesync_instance{};
+    std::unique_ptr<DirectVideoCapture> m_direct_video_capture;
+    std::unique_ptr<PTZController> m_ptz_controller;
+    NDIlib_recv_bandwidth_e m_bandwidth;
+    ReceiveMode m_receive_mode;
+    bool m_allows_video_fields;
+
+    void destroy();
+};
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "NDIReceiverReaper.h"
+
+namespace Carousel
+{
+NDIReceiverReaper::NDIReceiverReaper() : m_thread([this](std::stop_token stop_token) { run(stop_token); }) {}
+
+void NDIReceiverReaper::reap(std::unique_ptr<NDIReceiver> receiver)
+{
+    if (!receiver)
+        return;
+
+    {
+        std::lock_guard lock(m_mutex);
+        m_receivers.push_back(std::move(receiver));
+    }
+
+    m_condition.notify_one();
+}
+
+void NDIReceiverReaper::reap(std::future<std::unique_ptr<NDIReceiver>> pending_receiver)
+{
+    if (!pending_receiver.valid())
+        return;
+
+    {
+        std::lock_guard lock(m_mutex);
+        m_pending_receivers.push_back(std::move(pending_receiver));
+    }
+
+    m_condition.notify_one();
+}
+
+void NDIReceiverReaper::reap(std::unique_ptr<Recorder> recorder)
+{
+    if (!recorder)
+        return;
+
+    {
+        std::lock_guard lock(m_mutex);
+        m_recorders.push_back(std::move(recorder));
+    }
+
+    m_condition.notify_one();
+}
+
+void NDIReceiverReaper::reap(std::unique_ptr<SourceCapture> source_capture)
+{
+    if (!source_capture)
+        return;
+
+    {
+        std::lock_guard lock(m_mutex);
+        m_source_captures.push_back(std::move(source_capture));
+    }
+
+    m_condition.notify_one();
+}
+
+void NDIReceiverReaper::run(std::stop_token stop_token)
+{
+    while (true)
+    {
+        std::vector<std::unique_ptr<NDIReceiver>> receivers;
+        std::vector<std::future<std::unique_ptr<NDIReceiver>>> pending_receivers;
+        std::vector<std::unique_ptr<Recorder>> recorders;
+        std::vector<std::unique_ptr<SourceCapture>> source_captures;
+
+        {
+            std::unique_lock lock(m_mutex);
+            m_condition.wait(lock, stop_token, [this]() {
+                return !m_receivers.empty() || !m_pending_receivers.empty() || !m_recorders.empty() ||
+                       !m_source_captures.empty();
+            });
+
+            std::swap(receivers, m_receivers);
+            std::swap(pending_receivers, m_pending_receivers);
+            std::swap(recorders, m_recorders);
+            std::swap(source_captures, m_source_captures);
+        }
+
+        // Even once we've been asked to stop, keep going until everything we were given has been destroyed.
+        if (receivers.empty() && pending_receivers.empty() && recorders.empty() && source_captures.empty())
+            return;
+
+        for (auto& pending_receiver : pending_receivers)
+        {
+            try
+            {
+                pending_receiver.get();
+            }
+            catch (const std::exception&)
+            {
+                // It never got created, so there's nothing for us to destroy.
+            }
+        }
+
+        receivers.clear();
+        recorders.clear();
+        source_captures.clear();
+    }
+}
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include "NDIReceiver.h"
+#include "Recorder.h"
+#include "SourceCapture.h"
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Carousel
+{
+// Destroying a receiver tears down its network connections, which can take long enough to cause a visible hitch. This
+// takes ownership of receivers that are no longer needed, and destroys them on its own thread instead. Recorders are
+// given to us for the same reason, as destroying one waits for everything it has buffered to be written out, as are
+// source captures, which have a receiver and maybe a recorder of their own.
+class NDIReceiverReaper
+{
+public:
+    NDIReceiverReaper();
+
+    NDIReceiverReaper(const NDIReceiverReaper&) = delete;
+
+    // Nothing else may be referencing the receiver by the time it is given to us.
+    void reap(std::unique_ptr<NDIReceiver>);
+    // For receivers that are still being created: we'll wait for them to finish before destroying them.
+    void reap(std::future<std::unique_ptr<NDIReceiver>>);
+    // The recorder should have been stopped, so that nothing else is recorded whilst it finishes.
+    void reap(std::unique_ptr<Recorder>);
+    void reap(std::unique_ptr<SourceCapture>);
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable_any m_condition;
+    std::vector<std::unique_ptr<NDIReceiver>> m_receivers;
+    std::vector<std::future<std::unique_ptr<NDIReceiver>>> m_pending_receivers;
+    std::vector<std::unique_ptr<Recorder>> m_recorders;
+    std::vector<std::unique_ptr<SourceCapture>> m_source_captures;
+    // Declared last, so that it is joined (having destroyed everything it was given) before anything else goes away.
+    std::jthread m_thread;
+
+    void run(std::stop_token);
+};
+}
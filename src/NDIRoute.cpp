@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "NDIRoute.h"
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace Carousel
+{
+NDIRoute::NDIRoute(std::string name) : m_name(std::move(name))
+{
+    NDIlib_routing_create_t routing_create(m_name.c_str());
+    if (!(m_routing_instance = NDIlib_routing_create(&routing_create)))
+        throw std::runtime_error("Failed to create NDI route");
+}
+
+NDIRoute::~NDIRoute() { NDIlib_routing_destroy(m_routing_instance); }
+
+bool NDIRoute::is_routed_to(const NDIlib_source_t& source) const
+{
+    return m_source_name == source.p_ndi_name &&
+           m_source_url_address == (source.p_url_address ? source.p_url_address : "");
+}
+
+bool NDIRoute::is_own_source(const NDIlib_source_t& source) const
+{
+    auto* own_source = NDIlib_routing_get_source_name(m_routing_instance);
+    return own_source && own_source->p_ndi_name && source.p_ndi_name &&
+           strcmp(own_source->p_ndi_name, source.p_ndi_name) == 0;
+}
+
+int NDIRoute::number_of_connections() const { return NDIlib_routing_get_no_connections(m_routing_instance, 0); }
+
+void NDIRoute::route_to(const NDIlib_source_t& source)
+{
+    if (!NDIlib_routing_change(m_routing_instance, &source))
+        throw std::runtime_error("Failed to change NDI route");
+
+    m_source_name = source.p_ndi_name;
+    m_source_url_address = source.p_url_address ? source.p_url_address : "";
+}
+
+void NDIRoute::clear()
+{
+    NDIlib_routing_clear(m_routing_instance);
+    m_source_name.clear();
+    m_source_url_address.clear();
+}
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include "NDI.h"
+#include <string>
+#include <string_view>
+
+namespace Carousel
+{
+// A source of our own (e.g. "MONITOR-1") that receivers are pointed at another source through. NDI just redirects them,
+// so nothing is received or decoded here, and switching what a route shows costs us nothing.
+class NDIRoute
+{
+public:
+    explicit NDIRoute(std::string name);
+    ~NDIRoute();
+
+    NDIRoute(const NDIRoute&) = delete;
+
+    const std::string& name() const { return m_name; }
+    // Both are empty when the route isn't pointing at anything.
+    std::string_view source_name() const { return m_source_name; }
+    std::string_view source_url_address() const { return m_source_url_address; }
+    bool is_routed_to(const NDIlib_source_t&) const;
+    // Whether the source is this route itself, as others find it on the network (e.g. "HOST (MONITOR-1)").
+    bool is_own_source(const NDIlib_source_t&) const;
+    int number_of_connections() const;
+
+    void route_to(const NDIlib_source_t&);
+    void clear();
+
+private:
+    std::string m_name;
+    std::string m_source_name;
+    std::string m_source_url_address;
+    NDIlib_routing_instance_t m_routing_instance{};
+};
+}
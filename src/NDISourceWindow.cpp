@@ -5,6 +5,16 @@
  */
 
 #include "NDISourceWindow.h"
+#include "Tracer.h"
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
 #include <imgui/imgui.h>
 #include <limits>
 #include <optional>
@@ -12,57 +22,126 @@
 
 namespace Carousel
 {
-NDISourceWindow::NDISourceWindow(const NDIlib_source_t& source) : m_source(source)
+NDISourceWindow::NDISourceWindow(const NDIlib_source_t& source, NDIReceiverReaper& receiver_reaper)
+    : NDISourceWindow(Source(source), Settings{}, receiver_reaper)
 {
-    JMP::ScopeGuard free_if_error_occurs = [this]() {
-        // NDI says: You should always destroy the receiver after the frame-sync has been destroyed.
-        if (m_framesync_instance)
-        {
-            NDIlib_framesync_destroy(m_framesync_instance);
-            m_framesync_instance = nullptr;
-        }
+}
 
-        if (m_receiver_instance)
-        {
-            NDIlib_recv_destroy(m_receiver_instance);
-            m_receiver_instance = nullptr;
-        }
-    };
+NDISourceWindow::NDISourceWindow(Source source, const Settings& settings, NDIReceiverReaper& receiver_reaper)
+    : m_source(std::move(source)), m_settings(settings), m_receiver_reaper(receiver_reaper),
+      m_receiver_statistics(std::make_shared<ReceiverStatistics>(m_source.m_name))
+{
+    set_frame_texture_filtering(m_settings.frame_texture_filtering);
+    apply_replay_settings();
+    create_receiver();
+}
 
-    create_receiver_and_framesync(m_receiver_bandwidth);
-    set_frame_texture_filtering(m_frame_texture_filtering);
+NDISourceWindow::~NDISourceWindow()
+{
+    // Recordings are left to finish writing on the reaper's thread, rather than holding up the render thread.
+    stop_recording();
+    for (auto& recorder : m_finishing_recorders)
+        m_receiver_reaper.reap(std::move(recorder));
 
-    free_if_error_occurs.disarm();
+    m_receiver_reaper.reap(std::move(m_source_capture));
+    m_receiver_reaper.reap(std::move(m_pending_receiver));
+    m_receiver_reaper.reap(std::move(m_standby_receiver));
+    m_receiver_reaper.reap(std::move(m_receiver));
 }
 
-NDISourceWindow::~NDISourceWindow()
+bool NDISourceWindow::poll()
+{
+    TraceScope trace_scope("Poll source");
+
+    // update() isn't called whilst we're in the multiviewer or the fullscreen output, so nothing would be there to let
+    // go of the controls. Stop the camera rather than leave it moving.
+    if (m_is_ptz_moving && !m_has_updated_since_poll)
+        stop_ptz();
+    m_has_updated_since_poll = false;
+    std::erase_if(m_finishing_recorders, [](auto& recorder) { return recorder->is_finished(); });
+
+    auto has_changed = take_pending_receiver();
+    has_changed |= promote_standby_receiver();
+    has_changed |= render_second_field();
+
+    if (m_receiver)
+    {
+        auto previous_frame_timecode = m_frame_timecode;
+        receive(*m_receiver, false);
+        has_changed |= m_frame_timecode != previous_frame_timecode;
+
+        if (is_capturing_metadata())
+            has_changed |= receive_metadata(*m_receiver);
+    }
+
+    // The meters are always moving, and so might the gamepad, a camera or a replay be.
+    if (is_audio_only() || is_steering_with_gamepad() || m_is_ptz_moving ||
+        (m_is_replay_window_open && m_is_replay_playing))
+        has_changed = true;
+
+    return has_changed;
+}
+
+bool NDISourceWindow::is_receiving_video() const
 {
-    // NDI says: You should always destroy the receiver after the frame-sync has been destroyed.
-    if (m_framesync_instance)
+    return m_settings.bandwidth != NDIlib_recv_bandwidth_audio_only &&
+           m_settings.bandwidth != NDIlib_recv_bandwidth_metadata_only;
+}
+
+void NDISourceWindow::record_audio_levels(const float* interleaved_samples, int number_of_frames,
+                                          int number_of_channels)
+{
+    number_of_channels = std::min(number_of_channels, s_maximum_audio_meter_channels);
+
+    std::array<float, s_maximum_audio_meter_channels> peak_levels{};
+    for (auto frame = 0; frame < number_of_frames; frame++)
     {
-        NDIlib_framesync_destroy(m_framesync_instance);
-        m_framesync_instance = nullptr;
+        for (auto channel = 0; channel < number_of_channels; channel++)
+            peak_levels[channel] = std::max(peak_levels[channel], std::abs(interleaved_samples[channel]));
+
+        interleaved_samples += number_of_channels;
     }
 
-    if (m_receiver_instance)
+    // The meters may not be drawn until after several callbacks, so keep the loudest until they take it.
+    for (auto channel = 0; channel < number_of_channels; channel++)
     {
-        NDIlib_recv_destroy(m_receiver_instance);
-        m_receiver_instance = nullptr;
+        auto& peak_level = m_audio_peak_levels[channel];
+        auto previous_peak_level = peak_level.load(std::memory_order_relaxed);
+        while (previous_peak_level < peak_levels[channel] &&
+               !peak_level.compare_exchange_weak(previous_peak_level, peak_levels[channel], std::memory_order_relaxed))
+        {
+        }
     }
+    m_number_of_audio_channels.store(number_of_channels, std::memory_order_relaxed);
 }
 
-bool NDISourceWindow::update()
+std::chrono::nanoseconds NDISourceWindow::poll_interval() const
 {
-    receive();
+    std::chrono::nanoseconds poll_interval = m_frame_interval;
 
-    int width{}, height{};
-    m_frame_texture.with_bound([&width, &height]() {
-        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
-        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
-    });
+    if (is_audio_only())
+        poll_interval = s_audio_meter_poll_interval;
+    else if (m_frame_interval.count() == 0)
+        poll_interval = s_unknown_frame_rate_poll_interval;
+    // Deinterlaced sources show two fields per frame.
+    else if (m_deinterlacer && m_settings.deinterlacing_mode != Deinterlacer::Mode::Weave)
+        poll_interval = m_frame_interval / 2;
+
+    if (is_steering_with_gamepad())
+        poll_interval = std::min<std::chrono::nanoseconds>(poll_interval, s_ptz_gamepad_poll_interval);
+
+    return poll_interval;
+}
+
+bool NDISourceWindow::update()
+{
+    TraceScope trace_scope("Update source window");
+    m_has_updated_since_poll = true;
+    auto width = m_frame_width;
+    auto height = m_frame_height;
 
     std::optional<float> frame_aspect_ratio;
-    if (height != 0)
+    if (height != 0 && is_receiving_video())
         frame_aspect_ratio = static_cast<float>(width) / static_cast<float>(height);
 
     // A docked window won't respect its size constraints, so don't even bother.
@@ -93,49 +172,172 @@ bool NDISourceWindow::update()
                 texture_size.x = texture_size.y * *frame_aspect_ratio;
         }
 
-        ImGui::Image(reinterpret_cast<ImTextureID>(m_frame_texture.name()), texture_size);
+        if (!is_receiving_video())
+        {
+            // There's no video to show, so just show what we're getting instead.
+            ImGui::BeginGroup();
+            if (!m_receiver)
+                draw_connection_state();
+            else if (is_audio_only())
+                draw_audio_meters();
+            else
+                draw_recent_metadata();
+            ImGui::EndGroup();
+        }
+        else if (m_frame_timecode != -1)
+        {
+            ImGui::Image(reinterpret_cast<ImTextureID>(m_frame_texture.name()), texture_size);
+
+            if (m_pending_receiver.valid() || m_standby_receiver)
+            {
+                ImGui::GetWindowDrawList()->AddText(ImGui::GetItemRectMin(), IM_COL32(255, 255, 0, 255),
+                                                    "Switching receiver...");
+            }
+
+            if (is_recording())
+            {
+                auto text_width = ImGui::CalcTextSize("REC").x;
+                ImGui::GetWindowDrawList()->AddText(
+                    ImVec2(ImGui::GetItemRectMax().x - text_width, ImGui::GetItemRectMin().y),
+                    IM_COL32(255, 0, 0, 255), "REC");
+            }
+        }
+        else
+        {
+            // We have nothing to show yet, so take up the same space with a placeholder describing why.
+            auto placeholder_position = ImGui::GetCursorPos();
+            draw_connection_state();
+            ImGui::SetCursorPos(placeholder_position);
+            ImGui::Dummy(texture_size);
+        }
 
         if (ImGui::IsItemClicked(ImGuiMouseButton_Right))
             ImGui::OpenPopup("NDI Source Settings");
+
+        m_displayed_height = texture_size.y * ImGui::GetIO().DisplayFramebufferScale.y;
+    }
+    else
+    {
+        // Collapsed, or a tab that isn't selected.
+        m_displayed_height = 0.0f;
     }
 
     if (ImGui::BeginPopup("NDI Source Settings"))
     {
         if (ImGui::BeginMenu("Bandwidth"))
         {
-            auto is_highest_bandwidth_enabled = m_receiver_bandwidth == NDIlib_recv_bandwidth_highest;
-            auto is_lowest_bandwidth_enabled = m_receiver_bandwidth == NDIlib_recv_bandwidth_lowest;
+            if (ImGui::MenuItem("Automatic", nullptr, &m_settings.automatic_bandwidth))
+            {
+                m_automatic_bandwidth_candidate.reset();
+                ImGui::MarkIniSettingsDirty();
+            }
+
+            ImGui::Separator();
+
+            // Choosing a bandwidth by hand turns automatic bandwidth off, otherwise it would just be changed back.
+            auto bandwidth_menu_item = [this](const char* label, NDIlib_recv_bandwidth_e bandwidth) {
+                auto is_selected = m_settings.bandwidth == bandwidth;
+                if (ImGui::MenuItem(label, nullptr, is_selected, !is_selected || m_settings.automatic_bandwidth))
+                {
+                    m_settings.automatic_bandwidth = false;
+                    set_bandwidth(bandwidth);
+                    ImGui::MarkIniSettingsDirty();
+                }
+            };
+
+            bandwidth_menu_item("Highest", NDIlib_recv_bandwidth_highest);
+            bandwidth_menu_item("Lowest", NDIlib_recv_bandwidth_lowest);
+            bandwidth_menu_item("Audio Only", NDIlib_recv_bandwidth_audio_only);
+            bandwidth_menu_item("Metadata Only", NDIlib_recv_bandwidth_metadata_only);
+
+            ImGui::EndMenu();
+        }
+
+        if (ImGui::BeginMenu("Receive Mode"))
+        {
+            auto is_framesync = m_settings.receive_mode == NDIReceiver::ReceiveMode::Framesync;
+            auto is_direct = m_settings.receive_mode == NDIReceiver::ReceiveMode::Direct;
 
-            if (ImGui::MenuItem("Highest", nullptr, is_highest_bandwidth_enabled, !is_highest_bandwidth_enabled))
+            if (ImGui::MenuItem("Framesync", nullptr, is_framesync, !is_framesync))
             {
-                m_receiver_bandwidth = NDIlib_recv_bandwidth_highest;
-                create_receiver_and_framesync(m_receiver_bandwidth);
+                set_receive_mode(NDIReceiver::ReceiveMode::Framesync);
+                ImGui::MarkIniSettingsDirty();
+            }
+
+            if (ImGui::MenuItem("Direct (lowest latency, no audio)", nullptr, is_direct,
+                                !is_direct && can_receive_directly()))
+            {
+                set_receive_mode(NDIReceiver::ReceiveMode::Direct);
+                ImGui::MarkIniSettingsDirty();
+            }
+
+            if (is_direct)
+            {
+                ImGui::Separator();
+
+                if (ImGui::SliderInt("Jitter buffer", &m_settings.jitter_buffer_frames, 0, 8, "%d frames",
+                                     ImGuiSliderFlags_AlwaysClamp))
+                    ImGui::MarkIniSettingsDirty();
+
+                ImGui::Text("Capture to display: %.2f ms", m_average_direct_latency_milliseconds);
+                if (auto* direct_video_capture = m_receiver ? m_receiver->direct_video_capture() : nullptr)
+                {
+                    ImGui::Text("Dropped to catch up: %llu",
+                                static_cast<unsigned long long>(direct_video_capture->number_of_dropped_frames()));
+                }
             }
 
-            if (ImGui::MenuItem("Lowest", nullptr, is_lowest_bandwidth_enabled, !is_lowest_bandwidth_enabled))
+            ImGui::EndMenu();
+        }
+
+        if (ImGui::BeginMenu("Deinterlacing"))
+        {
+            auto is_framesync = m_settings.receive_mode == NDIReceiver::ReceiveMode::Framesync;
+
+            if (ImGui::MenuItem("Deinterlace on GPU", nullptr, m_settings.gpu_deinterlacing, is_framesync))
             {
-                m_receiver_bandwidth = NDIlib_recv_bandwidth_lowest;
-                create_receiver_and_framesync(m_receiver_bandwidth);
+                set_gpu_deinterlacing(!m_settings.gpu_deinterlacing);
+                ImGui::MarkIniSettingsDirty();
             }
 
+            if (!is_framesync)
+                ImGui::TextDisabled("Only available in framesync mode");
+
+            ImGui::Separator();
+
+            auto deinterlacing_mode_menu_item = [this](const char* label, Deinterlacer::Mode deinterlacing_mode) {
+                if (ImGui::MenuItem(label, nullptr, m_settings.deinterlacing_mode == deinterlacing_mode,
+                                    m_settings.gpu_deinterlacing))
+                {
+                    m_settings.deinterlacing_mode = deinterlacing_mode;
+                    ImGui::MarkIniSettingsDirty();
+                }
+            };
+
+            deinterlacing_mode_menu_item("Weave", Deinterlacer::Mode::Weave);
+            deinterlacing_mode_menu_item("Bob", Deinterlacer::Mode::Bob);
+            deinterlacing_mode_menu_item("Motion Adaptive", Deinterlacer::Mode::MotionAdaptive);
+
             ImGui::EndMenu();
         }
 
         if (ImGui::BeginMenu("Filtering"))
         {
-            auto is_using_linear_filtering = m_frame_texture_filtering == GL_LINEAR;
-            auto is_using_nearest_filtering = m_frame_texture_filtering == GL_NEAREST;
+            auto is_using_linear_filtering = m_settings.frame_texture_filtering == GL_LINEAR;
+            auto is_using_nearest_filtering = m_settings.frame_texture_filtering == GL_NEAREST;
 
             if (ImGui::MenuItem("Linear", nullptr, is_using_linear_filtering, !is_using_linear_filtering))
             {
-                m_frame_texture_filtering = GL_LINEAR;
-                set_frame_texture_filtering(m_frame_texture_filtering);
+                m_settings.frame_texture_filtering = GL_LINEAR;
+                set_frame_texture_filtering(m_settings.frame_texture_filtering);
+                ImGui::MarkIniSettingsDirty();
             }
 
             if (ImGui::MenuItem("Nearest", nullptr, is_using_nearest_filtering, !is_using_nearest_filtering))
             {
-                m_frame_texture_filtering = GL_NEAREST;
-                set_frame_texture_filtering(m_frame_texture_filtering);
+                m_settings.frame_texture_filtering = GL_NEAREST;
+                set_frame_texture_filtering(m_settings.frame_texture_filtering);
+                ImGui::MarkIniSettingsDirty();
             }
 
             ImGui::EndMenu();
@@ -147,56 +349,276 @@ bool NDISourceWindow::update()
 
         if (ImGui::BeginMenu("Audio"))
         {
-            ImGui::SliderFloat("Volume", &m_audio_volume, 0.0f, 1.0f, "%.3f", ImGuiSliderFlags_AlwaysClamp);
+            if (ImGui::SliderFloat("Volume", &m_settings.audio_volume, 0.0f, 1.0f, "%.3f",
+                                   ImGuiSliderFlags_AlwaysClamp))
+                ImGui::MarkIniSettingsDirty();
             ImGui::SameLine();
-            ImGui::Checkbox("Mute", &m_audio_muted);
+            if (ImGui::Checkbox("Mute", &m_settings.audio_muted))
+                ImGui::MarkIniSettingsDirty();
+            ImGui::EndMenu();
+        }
+
+        if (ImGui::BeginMenu("Frame Pacing"))
+        {
+            draw_frame_pacing();
             ImGui::EndMenu();
         }
 
+        if (ImGui::BeginMenu("Receiver Statistics"))
+        {
+            draw_receiver_statistics();
+            ImGui::EndMenu();
+        }
+
+        if (ImGui::MenuItem("Metadata Viewer", nullptr, &m_is_metadata_viewer_open) && !m_is_metadata_viewer_open)
+            m_metadata.clear();
+
+        if (ImGui::BeginMenu("Instant Replay"))
+        {
+            draw_replay_settings();
+            ImGui::EndMenu();
+        }
+
+        // NDI only knows whether the camera can be steered once we've connected to it.
+        ImGui::MenuItem("PTZ Controls", nullptr, &m_is_ptz_window_open,
+                        m_is_ptz_window_open || (m_receiver && m_receiver->is_ptz_supported()));
+
         if (ImGui::MenuItem("Reconnect"))
-            create_receiver_and_framesync(m_receiver_bandwidth);
+            reconnect();
 
         ImGui::EndPopup();
     }
 
     ImGui::End();
 
+    if (m_is_metadata_viewer_open)
+        draw_metadata_viewer();
+
+    if (m_is_ptz_window_open)
+        draw_ptz_controls();
+
+    if (m_is_replay_window_open)
+        draw_replay_window();
+
     return !m_is_window_open;
 }
 
-void NDISourceWindow::create_receiver_and_framesync(NDIlib_recv_bandwidth_e bandwidth)
+void NDISourceWindow::update_automatic_bandwidth(bool is_over_budget)
+{
+    if (!m_settings.automatic_bandwidth || !is_receiving_video())
+    {
+        m_is_load_demoted = false;
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (is_over_budget)
+        m_last_over_budget_time = now;
+
+    // Focusing ends a demotion straight away, as does being drawn small enough that we'd be demoted anyway.
+    if (m_is_window_focused || m_displayed_height < s_proxy_stream_height)
+        m_is_load_demoted = false;
+
+    auto is_load_demotion_holding = m_is_load_demoted && now - m_last_over_budget_time < s_load_demotion_cooldown;
+
+    std::optional<NDIlib_recv_bandwidth_e> desired_bandwidth;
+    if (m_is_window_focused)
+        desired_bandwidth = NDIlib_recv_bandwidth_highest;
+    else if (is_over_budget || is_load_demotion_holding || m_displayed_height < s_proxy_stream_height)
+        desired_bandwidth = NDIlib_recv_bandwidth_lowest;
+    else if (m_displayed_height > s_proxy_stream_height * s_automatic_bandwidth_upgrade_margin)
+        desired_bandwidth = NDIlib_recv_bandwidth_highest;
+
+    if (!is_load_demotion_holding)
+        m_is_load_demoted = false;
+
+    // Already being at the lowest bandwidth whilst over budget counts too, or we'd switch up as soon as load drops.
+    if (is_over_budget && !m_is_window_focused && m_displayed_height >= s_proxy_stream_height &&
+        m_settings.bandwidth == NDIlib_recv_bandwidth_lowest)
+        m_is_load_demoted = true;
+
+    // Between the two thresholds, whatever we have is fine.
+    if (!desired_bandwidth || *desired_bandwidth == m_settings.bandwidth)
+    {
+        m_automatic_bandwidth_candidate.reset();
+        return;
+    }
+
+    if (m_automatic_bandwidth_candidate != desired_bandwidth)
+    {
+        m_automatic_bandwidth_candidate = desired_bandwidth;
+        m_automatic_bandwidth_candidate_since = now;
+    }
+
+    // Focusing a source is a deliberate choice to look at it closely, so that takes effect straight away. Everything
+    // else has to hold for a little while first, so that a brief spike or a window being resized doesn't cause churn.
+    if (!m_is_window_focused && now - m_automatic_bandwidth_candidate_since < s_automatic_bandwidth_change_delay)
+        return;
+
+    m_automatic_bandwidth_candidate.reset();
+    if (*desired_bandwidth == NDIlib_recv_bandwidth_lowest && is_over_budget &&
+        m_displayed_height >= s_proxy_stream_height)
+        m_is_load_demoted = true;
+    set_bandwidth(*desired_bandwidth);
+    ImGui::MarkIniSettingsDirty();
+}
+
+void NDISourceWindow::set_tally(bool on_program, bool on_preview)
+{
+    if (!m_receiver)
+        return;
+
+    if (m_has_sent_tally && m_is_tally_on_program == on_program && m_is_tally_on_preview == on_preview)
+        return;
+
+    NDIlib_tally_t tally{};
+    tally.on_program = on_program;
+    tally.on_preview = on_preview;
+
+    // This returns false if we aren't connected yet, but NDI will send it for us once we are.
+    NDIlib_recv_set_tally(m_receiver->receiver_instance(), &tally);
+
+    m_has_sent_tally = true;
+    m_is_tally_on_program = on_program;
+    m_is_tally_on_preview = on_preview;
+}
+
+void NDISourceWindow::set_bandwidth(NDIlib_recv_bandwidth_e bandwidth)
+{
+    if (m_settings.bandwidth == bandwidth)
+        return;
+
+    m_settings.bandwidth = bandwidth;
+    create_receiver();
+}
+
+void NDISourceWindow::set_receive_mode(NDIReceiver::ReceiveMode receive_mode)
+{
+    if (m_settings.receive_mode == receive_mode)
+        return;
+
+    m_settings.receive_mode = receive_mode;
+    create_receiver();
+}
+
+void NDISourceWindow::set_gpu_deinterlacing(bool gpu_deinterlacing)
+{
+    if (m_settings.gpu_deinterlacing == gpu_deinterlacing)
+        return;
+
+    m_settings.gpu_deinterlacing = gpu_deinterlacing;
+    create_receiver();
+}
+
+bool NDISourceWindow::wants_video_fields() const
 {
-    // NDI says: You should always destroy the receiver after the frame-sync has been destroyed.
-    if (m_framesync_instance)
+    // Direct mode could hand us individual fields, which we don't handle, so it is left to the SDK there.
+    return m_settings.gpu_deinterlacing && m_settings.receive_mode == NDIReceiver::ReceiveMode::Framesync;
+}
+
+void NDISourceWindow::create_receiver()
+{
+    if (!can_receive_directly())
+        m_settings.receive_mode = NDIReceiver::ReceiveMode::Framesync;
+
+    // Once this finishes, take_pending_receiver() will notice if it no longer matches our settings and start over, so
+    // there's no need to queue up another one behind it.
+    if (m_pending_receiver.valid())
+        return;
+
+    // Anything still waiting on its first frame is now out of date.
+    m_receiver_reaper.reap(std::move(m_standby_receiver));
+    m_receiver_error.clear();
+
+    // Creating the receiver and framesync can block for a while, so do it on another thread. The source is copied, as
+    // we shouldn't assume this window will outlive the creation.
+    //
+    // In direct mode, frames arrive on their own thread, so wake the render loop up for them in case it is waiting on
+    // events.
+    //
+    // UYVY is half the size of RGBA, and we convert it on the GPU (see UYVYConverter). Sources with alpha still come to
+    // us as RGBA. The deinterlacer only takes RGBA, so with fields we need NDI to convert them.
+    auto allow_video_fields = wants_video_fields();
+    auto color_format = allow_video_fields ? NDIlib_recv_color_format_RGBX_RGBA : NDIlib_recv_color_format_UYVY_RGBA;
+    m_pending_receiver =
+        std::async(std::launch::async, [source = m_source, bandwidth = m_settings.bandwidth, color_format,
+                                        receive_mode = m_settings.receive_mode, allow_video_fields]() {
+            return std::make_unique<NDIReceiver>(source.to_ndi_source(), bandwidth, color_format, receive_mode,
+                                                 allow_video_fields, []() { glfwPostEmptyEvent(); });
+        });
+}
+
+bool NDISourceWindow::take_pending_receiver()
+{
+    if (!m_pending_receiver.valid() ||
+        m_pending_receiver.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return false;
+
+    std::unique_ptr<NDIReceiver> receiver;
+
+    try
     {
-        NDIlib_framesync_destroy(m_framesync_instance);
-        m_framesync_instance = nullptr;
+        receiver = m_pending_receiver.get();
+    }
+    catch (const std::exception& ex)
+    {
+        fprintf(stderr, "Failed to create receiver for %s: %s\n", m_source.m_name.c_str(), ex.what());
+        m_receiver_error = ex.what();
+        return true;
     }
 
-    if (m_receiver_instance)
+    // Our settings were changed while this was being created.
+    if (receiver->bandwidth() != m_settings.bandwidth || receiver->receive_mode() != m_settings.receive_mode ||
+        receiver->allows_video_fields() != wants_video_fields())
     {
-        NDIlib_recv_destroy(m_receiver_instance);
-        m_receiver_instance = nullptr;
+        m_receiver_reaper.reap(std::move(receiver));
+        create_receiver();
+        return false;
     }
 
-    NDIlib_recv_create_v3_t receiver_create{};
-    // RGB(A) is likely the worst format for bandwidth reasons, but was the simplest to get going with. probably
-    // should prioritize support for one of the YUV formats that is subsampled, or maybe just all formats :^)
-    receiver_create.color_format = NDIlib_recv_color_format_RGBX_RGBA;
-    receiver_create.bandwidth = bandwidth;
-    receiver_create.source_to_connect_to = NDIlib_source_t(m_source.m_name.c_str(), m_source.m_url_address.c_str());
+    // With nothing on screen yet, there's nothing to keep around whilst we wait for video.
+    if (!m_receiver)
+    {
+        m_receiver = std::move(receiver);
+        m_has_sent_tally = false;
+        return true;
+    }
 
-    if (!(m_receiver_instance = NDIlib_recv_create_v3(&receiver_create)))
-        throw std::runtime_error("Failed to create NDI receiver instance");
+    m_standby_receiver = std::move(receiver);
+    m_standby_receiver_created_at = std::chrono::steady_clock::now();
+    return false;
+}
+
+bool NDISourceWindow::promote_standby_receiver()
+{
+    if (!m_standby_receiver)
+        return false;
+
+    // The first frame from the new receiver goes straight to the texture, so the swap itself is seamless. If the new
+    // receiver isn't going to get any video, there's nothing worth waiting for.
+    if (m_standby_receiver->is_receiving_video() && !receive(*m_standby_receiver, true) &&
+        std::chrono::steady_clock::now() - m_standby_receiver_created_at < s_standby_receiver_timeout)
+        return false;
 
-    if (!(m_framesync_instance = NDIlib_framesync_create(m_receiver_instance)))
-        throw std::runtime_error("Failed to create NDI framesync instance");
+    // We're called with the mixer lock held, so the audio callback sees either the old receiver or the new one, never
+    // a mix of the two. Once that lock is released, nothing can be referencing the old one.
+    m_receiver_reaper.reap(std::move(m_receiver));
+    m_receiver = std::move(m_standby_receiver);
+    m_has_sent_tally = false;
+    return true;
 }
 
-void NDISourceWindow::receive()
+bool NDISourceWindow::receive(NDIReceiver& receiver, bool force_upload)
 {
+    if (auto* direct_video_capture = receiver.direct_video_capture())
+        return receive_direct(*direct_video_capture);
+
+    // Asking for interleaved frames gets us both fields of interlaced sources as they were sent. Progressive sources
+    // still come back as progressive frames.
     NDIlib_video_frame_v2_t video_frame{};
-    NDIlib_framesync_capture_video(m_framesync_instance, &video_frame);
+    NDIlib_framesync_capture_video(receiver.framesync_instance(), &video_frame,
+                                   receiver.allows_video_fields() ? NDIlib_frame_format_type_interleaved
+                                                                  : NDIlib_frame_format_type_progressive);
 
     // With framesync, it's possible (and likely) we'll get the same frame multiple times. Don't update the texture if
     // the frame hasn't changed.
@@ -204,17 +626,783 @@ void NDISourceWindow::receive()
     // If we have not received even a single frame yet, NDI says:
     // "this will return NDIlib_video_frame_v2_t as an empty (all zero) structure"
     // So, check for p_data to be something first before checking the timecode.
-    if (video_frame.p_data && video_frame.timecode != m_frame_timecode)
+    auto has_frame = video_frame.p_data != nullptr;
+    if (has_frame && (force_upload || video_frame.timecode != m_frame_timecode))
+    {
+        // A forced upload is the first frame from a different receiver, whose timing has nothing to do with the last.
+        if (force_upload)
+            m_frame_pacing.break_continuity();
+        upload(video_frame);
+    }
+
+    NDIlib_framesync_free_video(receiver.framesync_instance(), &video_frame);
+
+    return has_frame;
+}
+
+bool NDISourceWindow::receive_direct(DirectVideoCapture& direct_video_capture)
+{
+    auto frame = direct_video_capture.take(m_settings.jitter_buffer_frames);
+    if (!frame)
+        return false;
+
+    upload(frame->video_frame);
+    direct_video_capture.free(*frame);
+
+    // If another frame replaces this one before the next swap, it's that one that gets shown.
+    m_unpresented_direct_frame_captured_at = frame->captured_at;
+
+    return true;
+}
+
+void NDISourceWindow::frame_presented(std::chrono::steady_clock::time_point presented_at)
+{
+    if (!m_unpresented_direct_frame_captured_at)
+        return;
+
+    auto latency_milliseconds =
+        std::chrono::duration<double, std::milli>(presented_at - *m_unpresented_direct_frame_captured_at).count();
+    m_average_direct_latency_milliseconds += (latency_milliseconds - m_average_direct_latency_milliseconds) * 0.1;
+    m_unpresented_direct_frame_captured_at.reset();
+}
+
+void NDISourceWindow::upload(const NDIlib_video_frame_v2_t& video_frame)
+{
+    TraceScope trace_scope("Upload");
+    m_frame_pacing.record_frame(std::chrono::steady_clock::now(), video_frame.timecode, video_frame.frame_rate_N,
+                                video_frame.frame_rate_D);
+
+    if (video_frame.frame_rate_N > 0 && video_frame.frame_rate_D > 0)
+    {
+        m_frame_interval = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(
+            static_cast<double>(video_frame.frame_rate_D) / static_cast<double>(video_frame.frame_rate_N)));
+    }
+
+    m_upload_timer.begin();
+
+    if (should_deinterlace(video_frame))
     {
-        m_frame_texture.with_bound([&video_frame]() {
+        // The deinterlacer renders into the frame texture, so it needs storage of the right size first.
+        if (video_frame.xres != m_frame_width || video_frame.yres != m_frame_height)
+        {
+            m_frame_texture.with_bound([&video_frame]() {
+                JMP::GL::Texture2D::set_data(0, GL_RGBA, video_frame.xres, video_frame.yres, GL_RGBA,
+                                             GL_UNSIGNED_BYTE, nullptr);
+            });
+        }
+
+        m_deinterlacer->upload(video_frame.xres, video_frame.yres, video_frame.p_data);
+        m_deinterlacer->render(m_frame_texture.name(), m_settings.deinterlacing_mode, 0);
+
+        m_is_second_field_pending = true;
+        m_second_field_due_at = std::chrono::steady_clock::now() + m_frame_interval / 2;
+    }
+    else
+    {
+        upload_to_texture(m_frame_texture, video_frame.xres == m_frame_width && video_frame.yres == m_frame_height,
+                          video_frame);
+        m_is_second_field_pending = false;
+    }
+
+    m_upload_timer.end();
+
+    m_frame_timecode = video_frame.timecode;
+    m_frame_width = video_frame.xres;
+    m_frame_height = video_frame.yres;
+    m_frame_serial++;
+}
+
+void NDISourceWindow::upload_to_texture(const JMP::GL::Texture2D& texture, bool is_texture_same_size,
+                                        const NDIlib_video_frame_v2_t& video_frame)
+{
+    if (video_frame.FourCC != NDIlib_FourCC_video_type_UYVY)
+    {
+        texture.with_bound([&video_frame]() {
             JMP::GL::Texture2D::set_data(0, GL_RGBA, video_frame.xres, video_frame.yres, GL_RGBA, GL_UNSIGNED_BYTE,
                                          video_frame.p_data);
         });
+        return;
+    }
 
-        m_frame_timecode = video_frame.timecode;
+    if (!m_uyvy_converter)
+    {
+        try
+        {
+            m_uyvy_converter = std::make_unique<UYVYConverter>();
+        }
+        catch (const std::exception& ex)
+        {
+            fprintf(stderr, "Failed to create UYVY converter for %s: %s\n", m_source.m_name.c_str(), ex.what());
+            return;
+        }
+    }
+
+    // The converter renders into the texture, so it needs storage of the right size first.
+    if (!is_texture_same_size)
+    {
+        texture.with_bound([&video_frame]() {
+            JMP::GL::Texture2D::set_data(0, GL_RGBA, video_frame.xres, video_frame.yres, GL_RGBA, GL_UNSIGNED_BYTE,
+                                         nullptr);
+        });
     }
 
-    NDIlib_framesync_free_video(m_framesync_instance, &video_frame);
+    m_uyvy_converter->convert(texture.name(), video_frame.xres, video_frame.yres, video_frame.line_stride_in_bytes,
+                              video_frame.p_data);
+}
+
+bool NDISourceWindow::should_deinterlace(const NDIlib_video_frame_v2_t& video_frame)
+{
+    if (video_frame.frame_format_type != NDIlib_frame_format_type_interleaved || !m_settings.gpu_deinterlacing ||
+        m_settings.deinterlacing_mode == Deinterlacer::Mode::Weave)
+        return false;
+
+    if (!m_deinterlacer)
+    {
+        try
+        {
+            m_deinterlacer = std::make_unique<Deinterlacer>();
+        }
+        catch (const std::exception& ex)
+        {
+            fprintf(stderr, "Failed to create deinterlacer for %s: %s\n", m_source.m_name.c_str(), ex.what());
+            m_settings.deinterlacing_mode = Deinterlacer::Mode::Weave;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool NDISourceWindow::render_second_field()
+{
+    if (!m_is_second_field_pending || std::chrono::steady_clock::now() < m_second_field_due_at)
+        return false;
+
+    m_is_second_field_pending = false;
+
+    // The mode may have been changed to weave since the first field, in which case that's already on screen.
+    if (m_settings.deinterlacing_mode == Deinterlacer::Mode::Weave)
+        return false;
+
+    m_upload_timer.begin();
+    m_deinterlacer->render(m_frame_texture.name(), m_settings.deinterlacing_mode, 1);
+    m_upload_timer.end();
+
+    m_frame_serial++;
+    return true;
+}
+
+bool NDISourceWindow::is_capturing_metadata() const
+{
+    return m_is_metadata_viewer_open || m_settings.bandwidth == NDIlib_recv_bandwidth_metadata_only;
+}
+
+bool NDISourceWindow::receive_metadata(NDIReceiver& receiver)
+{
+    // The framesync only deals with video and audio, so metadata comes straight from the receiver. Only asking for
+    // metadata means this never touches the video and audio the framesync (or direct capture thread) is after.
+    //
+    // The frame is copied into the ring rather than kept, as it has to be freed by the receiver it came from, which
+    // may well be gone by the time the ring gets around to overwriting it.
+    auto has_received_metadata = false;
+    NDIlib_metadata_frame_t metadata_frame{};
+    while (NDIlib_recv_capture_v3(receiver.receiver_instance(), nullptr, nullptr, &metadata_frame, 0) ==
+           NDIlib_frame_type_metadata)
+    {
+        m_metadata.push(metadata_frame);
+        NDIlib_recv_free_metadata(receiver.receiver_instance(), &metadata_frame);
+        has_received_metadata = true;
+    }
+
+    return has_received_metadata;
+}
+
+void NDISourceWindow::draw_audio_meters()
+{
+    auto number_of_channels = m_number_of_audio_channels.load(std::memory_order_relaxed);
+    if (number_of_channels == 0)
+    {
+        ImGui::TextDisabled("Waiting for audio...");
+        return;
+    }
+
+    auto fall_decibels = s_audio_meter_fall_decibels_per_second * ImGui::GetIO().DeltaTime;
+    auto meter_width = std::max(ImGui::GetContentRegionAvail().x, 100.0f);
+
+    for (auto channel = 0; channel < number_of_channels; channel++)
+    {
+        auto peak_level = m_audio_peak_levels[channel].exchange(0.0f, std::memory_order_relaxed);
+        auto peak_decibels = peak_level > 0.0f ? 20.0f * std::log10(peak_level) : s_audio_meter_floor_decibels;
+
+        auto& displayed_decibels = m_displayed_audio_levels_decibels[channel];
+        displayed_decibels = std::clamp(std::max(peak_decibels, displayed_decibels - fall_decibels),
+                                        s_audio_meter_floor_decibels, 0.0f);
+
+        char overlay[16];
+        snprintf(overlay, sizeof(overlay), "%.1f dB", displayed_decibels);
+        ImGui::ProgressBar(1.0f - displayed_decibels / s_audio_meter_floor_decibels, ImVec2(meter_width, 0.0f),
+                           overlay);
+    }
+}
+
+void NDISourceWindow::draw_recent_metadata() const
+{
+    if (m_metadata.empty())
+    {
+        ImGui::TextDisabled("Waiting for metadata...");
+        return;
+    }
+
+    auto first_index = m_metadata.size() - std::min(m_metadata.size(), s_number_of_recent_metadata_shown);
+    for (auto i = first_index; i < m_metadata.size(); i++)
+        ImGui::TextWrapped("%s", m_metadata[i].data.c_str());
+}
+
+void NDISourceWindow::draw_metadata_viewer()
+{
+    auto title = m_source.m_name + " Metadata";
+    if (!ImGui::Begin(title.c_str(), &m_is_metadata_viewer_open))
+    {
+        ImGui::End();
+        return;
+    }
+
+    m_metadata_filter.Draw("Filter", 240.0f);
+    ImGui::SameLine();
+    if (ImGui::Button("Clear"))
+        m_metadata.clear();
+    ImGui::SameLine();
+    ImGui::TextDisabled("%zu kept, %llu overwritten", m_metadata.size(),
+                        static_cast<unsigned long long>(m_metadata.number_of_overwritten_entries()));
+
+    if (ImGui::BeginChild("Metadata", ImVec2(0.0f, 0.0f), true, ImGuiWindowFlags_HorizontalScrollbar))
+    {
+        // Follow new metadata as it comes in, unless we've scrolled up to look at something.
+        auto is_scrolled_to_bottom = ImGui::GetScrollY() >= ImGui::GetScrollMaxY();
+
+        for (size_t i = 0; i < m_metadata.size(); i++)
+        {
+            auto& entry = m_metadata[i];
+            if (!m_metadata_filter.PassFilter(entry.data.c_str(), entry.data.c_str() + entry.data.size()))
+                continue;
+
+            ImGui::TextDisabled("%lld", static_cast<long long>(entry.timecode));
+            ImGui::SameLine();
+            ImGui::TextUnformatted(entry.data.c_str(), entry.data.c_str() + entry.data.size());
+        }
+
+        if (is_scrolled_to_bottom)
+            ImGui::SetScrollHereY(1.0f);
+    }
+    ImGui::EndChild();
+
+    ImGui::End();
+
+    // Closing the viewer stops capturing, so there's no point keeping what we had.
+    if (!m_is_metadata_viewer_open)
+        m_metadata.clear();
+}
+
+void NDISourceWindow::draw_connection_state() const
+{
+    if (m_pending_receiver.valid())
+        ImGui::TextDisabled("Creating receiver...");
+    else if (!m_receiver)
+        ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "%s", m_receiver_error.c_str());
+    else if (NDIlib_recv_get_no_connections(m_receiver->receiver_instance()) == 0)
+        ImGui::TextDisabled("Connecting to %s...", m_source.m_name.c_str());
+    else
+        ImGui::TextDisabled("Waiting for video...");
+}
+
+void NDISourceWindow::draw_frame_pacing()
+{
+    // Relative to the interval the source advertises, so that 1.0 is a perfectly paced frame.
+    std::array<float, FramePacingStatistics::s_number_of_histogram_buckets> histogram{};
+    auto& interval_histogram = m_frame_pacing.interval_histogram();
+    for (size_t i = 0; i < histogram.size(); i++)
+        histogram[i] = static_cast<float>(interval_histogram[i]);
+
+    ImGui::PlotHistogram("##Intervals", histogram.data(), static_cast<int>(histogram.size()), 0, nullptr, 0.0f,
+                         FLT_MAX, ImVec2(320.0f, 80.0f));
+    ImGui::TextDisabled("Frame interval, 0x to %.0fx expected",
+                        FramePacingStatistics::s_number_of_histogram_buckets *
+                            FramePacingStatistics::s_histogram_bucket_width);
+
+    ImGui::Text("Expected interval: %.2f ms", m_frame_pacing.expected_interval_milliseconds());
+    ImGui::Text("Average interval: %.2f ms", m_frame_pacing.average_interval_milliseconds());
+    ImGui::Text("Longest interval: %.2f ms", m_frame_pacing.maximum_interval_milliseconds());
+    ImGui::Text("Frames: %llu", static_cast<unsigned long long>(m_frame_pacing.number_of_frames()));
+    ImGui::Text("Repeated (arrived late): %llu",
+                static_cast<unsigned long long>(m_frame_pacing.number_of_repeated_frames()));
+    ImGui::Text("Skipped (never arrived): %llu",
+                static_cast<unsigned long long>(m_frame_pacing.number_of_skipped_frames()));
+
+    if (ImGui::Button("Reset"))
+        m_frame_pacing.reset();
+}
+
+void NDISourceWindow::sample_receiver_statistics()
+{
+    if (m_receiver)
+        m_receiver_statistics->sample(*m_receiver);
+}
+
+void NDISourceWindow::start_recording(const std::filesystem::path& directory)
+{
+    if (is_recording())
+        return;
+
+    auto now = std::time(nullptr);
+    char started_at[32];
+    std::strftime(started_at, sizeof(started_at), "%Y%m%d-%H%M%S", std::localtime(&now));
+
+    // Source names are "MACHINE (Source)", which isn't something we want in a filename.
+    auto name = m_source.m_name;
+    std::replace_if(name.begin(), name.end(), [](char c) { return !std::isalnum(static_cast<unsigned char>(c)); },
+                    '_');
+
+    std::unique_ptr<Recorder> recorder;
+    try
+    {
+        recorder = std::make_unique<Recorder>(directory / (name + "-" + started_at));
+        m_recording_error.clear();
+    }
+    catch (const std::exception& exception)
+    {
+        fprintf(stderr, "Failed to start recording %s: %s\n", m_source.m_name.c_str(), exception.what());
+        m_recording_error = exception.what();
+        return;
+    }
+
+    source_capture().exchange_recorder(std::move(recorder));
+}
+
+void NDISourceWindow::stop_recording()
+{
+    if (!m_source_capture)
+        return;
+
+    if (auto recorder = m_source_capture->exchange_recorder(nullptr))
+    {
+        recorder->stop();
+        m_finishing_recorders.push_back(std::move(recorder));
+    }
+
+    reap_source_capture_if_unused();
+}
+
+SourceCapture& NDISourceWindow::source_capture()
+{
+    if (!m_source_capture)
+        m_source_capture = std::make_unique<SourceCapture>(m_source.to_ndi_source());
+    return *m_source_capture;
+}
+
+void NDISourceWindow::reap_source_capture_if_unused()
+{
+    if (m_source_capture && !m_source_capture->recorder() && !m_source_capture->replay_buffer())
+        m_receiver_reaper.reap(std::move(m_source_capture));
+}
+
+void NDISourceWindow::draw_receiver_statistics() const
+{
+    auto statistics = m_receiver_statistics->snapshot();
+
+    ImGui::Text("Video: %lld frames, %lld dropped (%.2f%%)", static_cast<long long>(statistics.total_video_frames),
+                static_cast<long long>(statistics.dropped_video_frames), statistics.video_drop_rate() * 100.0f);
+    ImGui::Text("Audio: %lld frames, %lld dropped", static_cast<long long>(statistics.total_audio_frames),
+                static_cast<long long>(statistics.dropped_audio_frames));
+    ImGui::Text("Metadata: %lld frames, %lld dropped", static_cast<long long>(statistics.total_metadata_frames),
+                static_cast<long long>(statistics.dropped_metadata_frames));
+    ImGui::Text("Queued: %d video, %d audio, %d metadata", statistics.video_queue_depth, statistics.audio_queue_depth,
+                statistics.metadata_queue_depth);
+
+    ImGui::PlotLines("Video queue", statistics.video_queue_depth_history.data(), statistics.history_size, 0, nullptr,
+                     0.0f, FLT_MAX, ImVec2(240.0f, 40.0f));
+    ImGui::PlotLines("Video drops", statistics.video_drop_rate_history.data(), statistics.history_size, 0, nullptr,
+                     0.0f, 1.0f, ImVec2(240.0f, 40.0f));
+}
+
+bool NDISourceWindow::is_steering_with_gamepad() const
+{
+    return m_is_ptz_window_open && m_is_ptz_gamepad_enabled && glfwJoystickIsGamepad(GLFW_JOYSTICK_1);
+}
+
+void NDISourceWindow::draw_ptz_controls()
+{
+    // The receiver may have gone away (or been replaced by one that isn't connected yet) whilst we were open.
+    auto* ptz_controller = m_receiver && m_receiver->is_ptz_supported() ? &m_receiver->ptz_controller() : nullptr;
+    float pan_speed = 0.0f;
+    float tilt_speed = 0.0f;
+    float zoom_speed = 0.0f;
+    float focus_speed = 0.0f;
+
+    auto title = m_source.m_name + " PTZ";
+    auto is_window_expanded = ImGui::Begin(title.c_str(), &m_is_ptz_window_open, ImGuiWindowFlags_AlwaysAutoResize);
+
+    if (is_window_expanded && !ptz_controller)
+    {
+        ImGui::TextDisabled("This source can't be steered right now.");
+    }
+    else if (is_window_expanded)
+    {
+        // Dragging away from the middle of the pad pans and tilts, faster the further we drag.
+        auto pad_position = ImGui::GetCursorScreenPos();
+        ImGui::InvisibleButton("Pan/Tilt", ImVec2(s_ptz_pad_size, s_ptz_pad_size));
+        ImVec2 pad_center(pad_position.x + s_ptz_pad_size / 2.0f, pad_position.y + s_ptz_pad_size / 2.0f);
+        ImVec2 handle_position = pad_center;
+
+        if (ImGui::IsItemActive())
+        {
+            auto mouse_position = ImGui::GetMousePos();
+            auto x = std::clamp((mouse_position.x - pad_center.x) / (s_ptz_pad_size / 2.0f), -1.0f, 1.0f);
+            auto y = std::clamp((mouse_position.y - pad_center.y) / (s_ptz_pad_size / 2.0f), -1.0f, 1.0f);
+            handle_position =
+                ImVec2(pad_center.x + x * s_ptz_pad_size / 2.0f, pad_center.y + y * s_ptz_pad_size / 2.0f);
+
+            // NDI pans left and tilts up with positive speeds.
+            pan_speed = -x;
+            tilt_speed = -y;
+        }
+
+        auto* draw_list = ImGui::GetWindowDrawList();
+        draw_list->AddRectFilled(pad_position, ImVec2(pad_position.x + s_ptz_pad_size, pad_position.y + s_ptz_pad_size),
+                                 IM_COL32(40, 40, 40, 255));
+        draw_list->AddLine(ImVec2(pad_center.x, pad_position.y), ImVec2(pad_center.x, pad_position.y + s_ptz_pad_size),
+                           IM_COL32(90, 90, 90, 255));
+        draw_list->AddLine(ImVec2(pad_position.x, pad_center.y), ImVec2(pad_position.x + s_ptz_pad_size, pad_center.y),
+                           IM_COL32(90, 90, 90, 255));
+        draw_list->AddCircleFilled(handle_position, 6.0f, IM_COL32(255, 255, 255, 255));
+
+        ImGui::SliderFloat("Zoom", &m_ptz_zoom_speed, -1.0f, 1.0f, "%.2f", ImGuiSliderFlags_AlwaysClamp);
+        if (!ImGui::IsItemActive())
+            m_ptz_zoom_speed = 0.0f;
+
+        ImGui::SliderFloat("Focus", &m_ptz_focus_speed, -1.0f, 1.0f, "%.2f", ImGuiSliderFlags_AlwaysClamp);
+        if (!ImGui::IsItemActive())
+            m_ptz_focus_speed = 0.0f;
+        ImGui::SameLine();
+        if (ImGui::Button("Auto Focus"))
+            ptz_controller->auto_focus();
+
+        zoom_speed = m_ptz_zoom_speed;
+        focus_speed = m_ptz_focus_speed;
+
+        ImGui::Checkbox("Gamepad", &m_is_ptz_gamepad_enabled);
+        if (m_is_ptz_gamepad_enabled)
+        {
+            ImGui::SameLine();
+            GLFWgamepadstate gamepad_state;
+            if (glfwJoystickIsGamepad(GLFW_JOYSTICK_1) && glfwGetGamepadState(GLFW_JOYSTICK_1, &gamepad_state))
+            {
+                ImGui::TextDisabled("%s", glfwGetGamepadName(GLFW_JOYSTICK_1));
+
+                auto axis = [&gamepad_state](int axis) {
+                    auto value = gamepad_state.axes[axis];
+                    return std::abs(value) < s_ptz_gamepad_deadzone ? 0.0f : value;
+                };
+
+                // The left stick pans and tilts, the right stick zooms. The mouse wins whilst it's being used.
+                if (pan_speed == 0.0f && tilt_speed == 0.0f)
+                {
+                    pan_speed = -axis(GLFW_GAMEPAD_AXIS_LEFT_X);
+                    tilt_speed = -axis(GLFW_GAMEPAD_AXIS_LEFT_Y);
+                }
+
+                if (zoom_speed == 0.0f)
+                    zoom_speed = -axis(GLFW_GAMEPAD_AXIS_RIGHT_Y);
+            }
+            else
+            {
+                ImGui::TextDisabled("No gamepad connected");
+            }
+        }
+
+        ImGui::SeparatorText("Presets");
+        ImGui::SliderInt("Preset", &m_ptz_preset, 0, PTZController::s_number_of_presets - 1, "%d",
+                         ImGuiSliderFlags_AlwaysClamp);
+        ImGui::SliderFloat("Recall speed", &m_ptz_preset_recall_speed, 0.0f, 1.0f, "%.2f",
+                           ImGuiSliderFlags_AlwaysClamp);
+        if (ImGui::Button("Recall"))
+            ptz_controller->recall_preset(m_ptz_preset, m_ptz_preset_recall_speed);
+        ImGui::SameLine();
+        if (ImGui::Button("Store"))
+            ptz_controller->store_preset(m_ptz_preset);
+
+        ImGui::SeparatorText("White Balance");
+        if (ImGui::Button("Auto##WhiteBalance"))
+            ptz_controller->set_white_balance(PTZController::WhiteBalance::Auto);
+        ImGui::SameLine();
+        if (ImGui::Button("Indoor"))
+            ptz_controller->set_white_balance(PTZController::WhiteBalance::Indoor);
+        ImGui::SameLine();
+        if (ImGui::Button("Outdoor"))
+            ptz_controller->set_white_balance(PTZController::WhiteBalance::Outdoor);
+        ImGui::SameLine();
+        if (ImGui::Button("One Shot"))
+            ptz_controller->set_white_balance(PTZController::WhiteBalance::OneShot);
+
+        ImGui::SeparatorText("Exposure");
+        if (ImGui::Checkbox("Auto##Exposure", &m_is_ptz_exposure_auto) && m_is_ptz_exposure_auto)
+            ptz_controller->set_exposure_auto();
+
+        if (!m_is_ptz_exposure_auto &&
+            ImGui::SliderFloat("Level", &m_ptz_exposure_level, 0.0f, 1.0f, "%.2f", ImGuiSliderFlags_AlwaysClamp))
+            ptz_controller->set_exposure_manual(m_ptz_exposure_level);
+    }
+    ImGui::End();
+
+    if (!m_is_ptz_window_open)
+        pan_speed = tilt_speed = zoom_speed = focus_speed = 0.0f;
+
+    // Speeds are sent even when we're collapsed or closed, which is how the camera gets stopped.
+    if (ptz_controller)
+    {
+        ptz_controller->set_pan_tilt_speed(pan_speed, tilt_speed);
+        ptz_controller->set_zoom_speed(zoom_speed);
+        ptz_controller->set_focus_speed(focus_speed);
+    }
+
+    m_is_ptz_moving = pan_speed != 0.0f || tilt_speed != 0.0f || zoom_speed != 0.0f || focus_speed != 0.0f;
+}
+
+void NDISourceWindow::stop_ptz()
+{
+    if (m_receiver && m_receiver->is_ptz_supported())
+    {
+        auto& ptz_controller = m_receiver->ptz_controller();
+        ptz_controller.set_pan_tilt_speed(0.0f, 0.0f);
+        ptz_controller.set_zoom_speed(0.0f);
+        ptz_controller.set_focus_speed(0.0f);
+    }
+
+    m_is_ptz_moving = false;
+}
+
+void NDISourceWindow::apply_replay_settings()
+{
+    if (m_settings.replay_seconds <= 0)
+    {
+        if (m_source_capture)
+            m_source_capture->exchange_replay_buffer(nullptr);
+        reap_source_capture_if_unused();
+        m_is_replay_window_open = false;
+        return;
+    }
+
+    auto budget_bytes = static_cast<size_t>(m_settings.replay_budget_megabytes) * 1024 * 1024;
+    auto maximum_duration = std::chrono::seconds(m_settings.replay_seconds);
+
+    if (auto* replay_buffer = this->replay_buffer(); replay_buffer && replay_buffer->budget_bytes() == budget_bytes)
+    {
+        auto lock = m_source_capture->lock();
+        replay_buffer->set_maximum_duration(maximum_duration);
+        return;
+    }
+
+    // Let go of the old buffer first, so we never hold both budgets at once. The new one is made (and touched) before
+    // it's swapped in, so the capture thread isn't kept waiting on it.
+    if (m_source_capture)
+        m_source_capture->exchange_replay_buffer(nullptr);
+    m_uploaded_replay_serial.reset();
+
+    std::unique_ptr<ReplayBuffer> replay_buffer;
+    try
+    {
+        replay_buffer = std::make_unique<ReplayBuffer>(budget_bytes, maximum_duration);
+    }
+    catch (const std::bad_alloc&)
+    {
+        fprintf(stderr, "Failed to allocate %d MB for replaying %s\n", m_settings.replay_budget_megabytes,
+                m_source.m_name.c_str());
+        m_settings.replay_seconds = 0;
+        m_is_replay_window_open = false;
+        reap_source_capture_if_unused();
+        return;
+    }
+
+    source_capture().exchange_replay_buffer(std::move(replay_buffer));
+}
+
+void NDISourceWindow::draw_replay_settings()
+{
+    auto is_enabled = m_settings.replay_seconds > 0;
+    if (ImGui::Checkbox("Keep frames for replay", &is_enabled))
+    {
+        m_settings.replay_seconds = is_enabled ? 10 : 0;
+        apply_replay_settings();
+        ImGui::MarkIniSettingsDirty();
+    }
+
+    if (!is_enabled)
+        return;
+
+    if (ImGui::SliderInt("Length", &m_settings.replay_seconds, 1, s_maximum_replay_seconds, "%d s",
+                         ImGuiSliderFlags_AlwaysClamp))
+    {
+        apply_replay_settings();
+        ImGui::MarkIniSettingsDirty();
+    }
+
+    // Reallocating throws away what we have, so only do it once the slider is let go.
+    if (ImGui::SliderInt("Memory budget", &m_settings.replay_budget_megabytes, s_minimum_replay_budget_megabytes,
+                         s_maximum_replay_budget_megabytes, "%d MB", ImGuiSliderFlags_AlwaysClamp))
+        ImGui::MarkIniSettingsDirty();
+    if (ImGui::IsItemDeactivatedAfterEdit())
+        apply_replay_settings();
+
+    if (!replay_buffer())
+        return;
+
+    auto lock = m_source_capture->lock();
+    auto& replay_buffer = *this->replay_buffer();
+    ImGui::Text("%.0f MB allocated, %.0f MB in use", static_cast<double>(replay_buffer.budget_bytes()) / 1048576.0,
+                static_cast<double>(replay_buffer.used_bytes()) / 1048576.0);
+    ImGui::Text("Holding %.1f s (%zu frames)", std::chrono::duration<double>(replay_buffer.duration()).count(),
+                replay_buffer.size());
+
+    // The budget has to cover the length we asked for, and it's easy to ask for more than fits. The frames are from
+    // the capture connection, so their size and rate needn't match what the window is showing.
+    auto newest_video_frame = replay_buffer.empty() ? NDIlib_video_frame_v2_t{}
+                                                    : replay_buffer[replay_buffer.size() - 1].video_frame;
+    if (newest_video_frame.frame_rate_N > 0 && newest_video_frame.frame_rate_D > 0)
+    {
+        auto frame_size = video_frame_data_size(newest_video_frame);
+        auto seconds_that_fit = static_cast<double>(replay_buffer.budget_bytes() / frame_size) *
+                                static_cast<double>(newest_video_frame.frame_rate_D) /
+                                static_cast<double>(newest_video_frame.frame_rate_N);
+        auto frame_size_megabytes = static_cast<double>(frame_size) / 1048576.0;
+
+        if (seconds_that_fit < m_settings.replay_seconds)
+        {
+            ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "%.1f MB per frame, so the budget only fits %.1f s",
+                               frame_size_megabytes, seconds_that_fit);
+        }
+        else
+        {
+            ImGui::TextDisabled("%.1f MB per frame, so the budget fits %.1f s", frame_size_megabytes,
+                                seconds_that_fit);
+        }
+    }
+
+    if (replay_buffer.number_of_oversized_frames() > 0)
+    {
+        ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "%llu frames were bigger than the whole budget",
+                           static_cast<unsigned long long>(replay_buffer.number_of_oversized_frames()));
+    }
+
+    // Open on the newest frame.
+    if (ImGui::MenuItem("Open Replay", nullptr, &m_is_replay_window_open) && m_is_replay_window_open)
+    {
+        m_replay_serial = std::numeric_limits<uint64_t>::max();
+        m_is_replay_playing = false;
+    }
+}
+
+void NDISourceWindow::draw_replay_window()
+{
+    auto title = m_source.m_name + " Replay";
+    if (!ImGui::Begin(title.c_str(), &m_is_replay_window_open))
+    {
+        ImGui::End();
+        return;
+    }
+
+    // Held until we're done with the frame, as the capture thread pushes (and evicts) whilst we're here.
+    std::unique_lock<std::mutex> lock;
+    if (replay_buffer())
+        lock = m_source_capture->lock();
+
+    if (!replay_buffer() || replay_buffer()->empty())
+    {
+        ImGui::TextDisabled("Nothing to replay yet");
+        ImGui::End();
+        return;
+    }
+
+    auto& replay_buffer = *this->replay_buffer();
+    auto newest_index = replay_buffer.size() - 1;
+    // If the frame we were on has been evicted, this is the oldest we still have.
+    auto index = replay_buffer.index_of(m_replay_serial);
+    auto now = std::chrono::steady_clock::now();
+
+    // Frames are played back at the pace they came in.
+    if (m_is_replay_playing && index < newest_index)
+    {
+        auto frame_duration = replay_buffer[index + 1].received_at - replay_buffer[index].received_at;
+        if (now - m_replay_frame_shown_at >= frame_duration)
+        {
+            index++;
+            m_replay_frame_shown_at = now;
+        }
+    }
+    else if (m_is_replay_playing)
+    {
+        // Caught up with live.
+        m_is_replay_playing = false;
+    }
+
+    auto scrub_index = static_cast<int>(index);
+    char scrub_label[32];
+    snprintf(scrub_label, sizeof(scrub_label), "-%.2f s",
+             std::chrono::duration<double>(replay_buffer[newest_index].received_at - replay_buffer[index].received_at)
+                 .count());
+
+    ImGui::SetNextItemWidth(-160.0f);
+    if (ImGui::SliderInt("##Scrub", &scrub_index, 0, static_cast<int>(newest_index), scrub_label,
+                         ImGuiSliderFlags_AlwaysClamp))
+    {
+        index = static_cast<size_t>(scrub_index);
+        m_is_replay_playing = false;
+    }
+
+    ImGui::SameLine();
+    if (ImGui::Button(m_is_replay_playing ? "Pause" : "Play"))
+    {
+        m_is_replay_playing = !m_is_replay_playing;
+        m_replay_frame_shown_at = now;
+
+        // Playing from the end starts again from the beginning.
+        if (m_is_replay_playing && index == newest_index)
+            index = 0;
+    }
+
+    ImGui::SameLine();
+    if (ImGui::Button("Newest"))
+    {
+        index = newest_index;
+        m_is_replay_playing = false;
+    }
+
+    m_replay_serial = replay_buffer[index].serial;
+
+    // Straight from memory, the receiver doesn't know we're doing this at all.
+    if (m_uploaded_replay_serial != m_replay_serial)
+    {
+        auto& video_frame = replay_buffer[index].video_frame;
+        upload_to_texture(m_replay_texture,
+                          video_frame.xres == m_replay_texture_width && video_frame.yres == m_replay_texture_height,
+                          video_frame);
+
+        m_replay_texture_width = video_frame.xres;
+        m_replay_texture_height = video_frame.yres;
+        m_uploaded_replay_serial = m_replay_serial;
+    }
+
+    auto image_size = ImGui::GetContentRegionAvail();
+    if (m_replay_texture_width > 0 && m_replay_texture_height > 0)
+    {
+        auto aspect_ratio = static_cast<float>(m_replay_texture_width) / static_cast<float>(m_replay_texture_height);
+        if (aspect_ratio > image_size.x / image_size.y)
+            image_size.y = image_size.x / aspect_ratio;
+        else
+            image_size.x = image_size.y * aspect_ratio;
+    }
+
+    ImGui::Image(reinterpret_cast<ImTextureID>(m_replay_texture.name()), image_size);
+
+    ImGui::End();
 }
 
 void NDISourceWindow::set_frame_texture_filtering(GLint filtering)
@@ -223,5 +1411,9 @@ void NDISourceWindow::set_frame_texture_filtering(GLint filtering)
         JMP::GL::Texture2D::set_parameter(GL_TEXTURE_MIN_FILTER, filtering);
         JMP::GL::Texture2D::set_parameter(GL_TEXTURE_MAG_FILTER, filtering);
     });
+    m_replay_texture.with_bound([filtering]() {
+        JMP::GL::Texture2D::set_parameter(GL_TEXTURE_MIN_FILTER, filtering);
+        JMP::GL::Texture2D::set_parameter(GL_TEXTURE_MAG_FILTER, filtering);
+    });
 }
 }
\ No newline at end of file
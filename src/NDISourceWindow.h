@@ -6,9 +6,30 @@
 
 #pragma once
 
+#include "Deinterlacer.h"
+#include "FramePacingStatistics.h"
+#include "GPUTimer.h"
+#include "MetadataRing.h"
 #include "NDI.h"
+#include "NDIReceiver.h"
+#include "NDIReceiverReaper.h"
+#include "ReceiverStatistics.h"
+#include "Recorder.h"
+#include "ReplayBuffer.h"
+#include "SourceCapture.h"
+#include "UYVYConverter.h"
 #include <JMP/GL/Texture.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <imgui/imgui.h>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
 namespace Carousel
 {
@@ -26,9 +47,17 @@ public:
         {
         }
 
+        Source(std::string name, std::string url_address)
+            : m_name(std::move(name)), m_url_address(std::move(url_address))
+        {
+        }
+
         std::string_view name() const { return m_name; }
         std::string_view url_address() const { return m_url_address; }
 
+        // The returned structure points into this object, so it must not outlive it.
+        NDIlib_source_t to_ndi_source() const { return NDIlib_source_t(m_name.c_str(), m_url_address.c_str()); }
+
         bool operator==(const NDIlib_source_t& rhs) const
         {
             return name() == rhs.p_ndi_name && url_address() == rhs.p_url_address;
@@ -39,36 +68,239 @@ public:
         std::string m_url_address;
     };
 
-    explicit NDISourceWindow(const NDIlib_source_t&);
+    // Everything about a source window that is persisted between sessions, aside from the source itself.
+    struct Settings
+    {
+        NDIlib_recv_bandwidth_e bandwidth = NDIlib_recv_bandwidth_highest;
+        GLint frame_texture_filtering = GL_LINEAR;
+        float audio_volume = 1.0f;
+        bool audio_muted = true;
+        // Let us pick the bandwidth ourselves, see update_automatic_bandwidth().
+        bool automatic_bandwidth{};
+        NDIReceiver::ReceiveMode receive_mode = NDIReceiver::ReceiveMode::Framesync;
+        // How many frames direct mode keeps queued up before showing one, to smooth out uneven arrival.
+        int jitter_buffer_frames = 1;
+        // Deinterlace ourselves on the GPU instead of letting the SDK do it on the CPU. Only in framesync mode.
+        bool gpu_deinterlacing{};
+        Deinterlacer::Mode deinterlacing_mode = Deinterlacer::Mode::MotionAdaptive;
+        // How many seconds of frames to keep for instant replay, or 0 to not keep any. All of the budget is allocated
+        // as soon as replay is turned on.
+        int replay_seconds{};
+        int replay_budget_megabytes = 512;
+    };
+
+    static constexpr int s_maximum_replay_seconds = 120;
+    static constexpr int s_minimum_replay_budget_megabytes = 64;
+    static constexpr int s_maximum_replay_budget_megabytes = 8192;
+
+    NDISourceWindow(const NDIlib_source_t&, NDIReceiverReaper&);
+    NDISourceWindow(Source, const Settings&, NDIReceiverReaper&);
     ~NDISourceWindow();
 
     NDISourceWindow(const NDISourceWindow&) = delete;
 
     const Source& source() const { return m_source; }
-    NDIlib_framesync_instance_t framesync_instance() const { return m_framesync_instance; }
-    float audio_volume() const { return m_audio_volume; }
-    bool is_audio_muted() const { return m_audio_muted; }
+    const Settings& settings() const { return m_settings; }
+    // This is null until the receiver has finished being created.
+    NDIReceiver* receiver() const { return m_receiver.get(); }
+    float audio_volume() const { return m_settings.audio_volume; }
+    bool is_audio_muted() const { return m_settings.audio_muted; }
     bool is_window_focused() const { return m_is_window_focused; }
+    bool is_receiving_video() const;
+    bool is_audio_only() const { return m_settings.bandwidth == NDIlib_recv_bandwidth_audio_only; }
+    // Called from the audio callback (with the mixer lock held) with the samples we got for this source, so that audio
+    // only windows can show meters.
+    void record_audio_levels(const float* interleaved_samples, int number_of_frames, int number_of_channels);
+    // For when something other than our own window (such as the multiviewer) is displaying this source.
+    void set_window_focused(bool is_window_focused) { m_is_window_focused = is_window_focused; }
+    // How many pixels tall this source is being drawn. Our own window sets this in update(), but like focus, something
+    // else drawing this source may set it instead.
+    void set_displayed_height(float displayed_height) { m_displayed_height = displayed_height; }
+    bool is_visible() const { return m_displayed_height > 0.0f; }
+    // Tells the sender whether we're showing it. This is only sent on to NDI when it changes, or we get a new receiver
+    // (NDI keeps sending it across reconnections of the same receiver by itself).
+    void set_tally(bool on_program, bool on_preview);
+    const JMP::GL::Texture2D& frame_texture() const { return m_frame_texture; }
+    int frame_width() const { return m_frame_width; }
+    int frame_height() const { return m_frame_height; }
+    // Incremented every time a new frame is uploaded to the frame texture.
+    uint64_t frame_serial() const { return m_frame_serial; }
+    const GPUTimer& upload_timer() const { return m_upload_timer; }
+    const FramePacingStatistics& frame_pacing() const { return m_frame_pacing; }
+    void reset_frame_pacing() { m_frame_pacing.reset(); }
+    // Called once whatever we've drawn has been swapped to the screen.
+    void frame_presented(std::chrono::steady_clock::time_point presented_at);
+    const ReceiverStatistics& receiver_statistics() const { return *m_receiver_statistics; }
+    std::shared_ptr<const ReceiverStatistics> shared_receiver_statistics() const { return m_receiver_statistics; }
+    // Must be called with the mixer lock held, so the receiver can't be swapped out from under us.
+    void sample_receiver_statistics();
+
+    // Recordings are named after the source and when they were started. They're fed by a SourceCapture, not anything
+    // the audio callback touches, so neither of these need the mixer lock.
+    void start_recording(const std::filesystem::path& directory);
+    void stop_recording();
+    bool is_recording() const { return recorder() != nullptr; }
+    // Null whilst we aren't recording.
+    const Recorder* recorder() const { return m_source_capture ? m_source_capture->recorder() : nullptr; }
+    const std::string& recording_error() const { return m_recording_error; }
 
+    // All of these keep the current receiver running until its replacement has produced its first frame.
+    void set_bandwidth(NDIlib_recv_bandwidth_e);
+    void set_receive_mode(NDIReceiver::ReceiveMode);
+    void set_gpu_deinterlacing(bool);
+    void reconnect() { create_receiver(); }
+
+    // Picks up new frames and finished receivers. Returns true if anything changed that is worth drawing.
+    bool poll();
+    // How long we can go between calls to poll() without missing a frame.
+    std::chrono::nanoseconds poll_interval() const;
     bool update();
+    // If automatic bandwidth is enabled, switches to the lowest bandwidth (the proxy stream) when we're drawn smaller
+    // than it or the application is over its frame time budget, and back to the highest when focused or drawn larger.
+    void update_automatic_bandwidth(bool is_over_budget);
 
 private:
+    // How long a replacement receiver may go without video before we give up waiting and use it anyway.
+    static constexpr std::chrono::seconds s_standby_receiver_timeout{5};
+    // How often to poll whilst we don't know the frame rate of the source yet.
+    static constexpr std::chrono::milliseconds s_unknown_frame_rate_poll_interval{100};
+    // NDI's proxy (lowest bandwidth) stream is 640x360.
+    static constexpr float s_proxy_stream_height = 360.0f;
+    // Don't switch back to the highest bandwidth until we're drawn this much larger than the proxy stream, so sizing a
+    // window right around it doesn't flip back and forth.
+    static constexpr float s_automatic_bandwidth_upgrade_margin = 1.25f;
+    // How long automatic bandwidth has to want a different bandwidth before it actually switches.
+    static constexpr std::chrono::seconds s_automatic_bandwidth_change_delay{2};
+    // A source demoted because we were over budget stays demoted until we've been under budget for this long, as
+    // promoting it is what would put us back over.
+    static constexpr std::chrono::seconds s_load_demotion_cooldown{30};
+    // Without video to pace us, this is how often meters are redrawn.
+    static constexpr std::chrono::milliseconds s_audio_meter_poll_interval{33};
+    static constexpr int s_maximum_audio_meter_channels = 8;
+    // Meters show from here up to 0 dBFS, and fall back down at the given rate.
+    static constexpr float s_audio_meter_floor_decibels = -60.0f;
+    static constexpr float s_audio_meter_fall_decibels_per_second = 20.0f;
+    static constexpr size_t s_metadata_ring_capacity = 512;
+    // The compact view for metadata only sources just shows the newest few.
+    static constexpr size_t s_number_of_recent_metadata_shown = 32;
+    static constexpr float s_ptz_pad_size = 160.0f;
+    // Sticks rarely rest at exactly zero, and we don't want a camera slowly drifting off.
+    static constexpr float s_ptz_gamepad_deadzone = 0.15f;
+    // Gamepads don't wake us up when they move, so we have to go and look this often whilst one is steering.
+    static constexpr std::chrono::milliseconds s_ptz_gamepad_poll_interval{33};
+
     bool m_is_window_open = true;
     bool m_is_window_focused{};
+    float m_displayed_height{};
+    // What we last sent as tally. Cleared whenever the receiver is replaced, as the new one hasn't been sent anything;
+    // comparing receiver pointers isn't enough, as a new receiver could be allocated where an old one was.
+    bool m_has_sent_tally{};
+    bool m_is_tally_on_program{};
+    bool m_is_tally_on_preview{};
+    std::optional<NDIlib_recv_bandwidth_e> m_automatic_bandwidth_candidate;
+    std::chrono::steady_clock::time_point m_automatic_bandwidth_candidate_since;
+    // Set whilst we're at the lowest bandwidth because of load, rather than how large we're drawn.
+    bool m_is_load_demoted{};
+    std::chrono::steady_clock::time_point m_last_over_budget_time;
     Source m_source;
-    NDIlib_recv_instance_t m_receiver_instance{};
-    NDIlib_framesync_instance_t m_framesync_instance{};
+    Settings m_settings;
+    NDIReceiverReaper& m_receiver_reaper;
+    std::unique_ptr<NDIReceiver> m_receiver;
+    // Receivers are created off the render thread, and will appear here until they are taken by update().
+    std::future<std::unique_ptr<NDIReceiver>> m_pending_receiver;
+    // A replacement for m_receiver that is waiting on its first video frame.
+    std::unique_ptr<NDIReceiver> m_standby_receiver;
+    std::chrono::steady_clock::time_point m_standby_receiver_created_at;
+    std::string m_receiver_error;
     JMP::GL::Texture2D m_frame_texture;
-    NDIlib_recv_bandwidth_e m_receiver_bandwidth = NDIlib_recv_bandwidth_highest;
-    GLint m_frame_texture_filtering = GL_LINEAR;
-    float m_audio_volume = 1.0f;
-    bool m_audio_muted = true;
+    GPUTimer m_upload_timer;
     // Initialized at -1, so that if we receive a timecode of 0, we properly take that first frame.
     // This timecode is seen always and constantly by the Test Patterns NDI Tool
     int64_t m_frame_timecode = -1;
+    int m_frame_width{};
+    int m_frame_height{};
+    uint64_t m_frame_serial{};
+    std::chrono::nanoseconds m_frame_interval{};
+    FramePacingStatistics m_frame_pacing;
+    // From a frame being captured in direct mode to the buffer swap that puts it on screen.
+    double m_average_direct_latency_milliseconds{};
+    std::optional<std::chrono::steady_clock::time_point> m_unpresented_direct_frame_captured_at;
+    // Written by the audio callback, read by update().
+    std::array<std::atomic<float>, s_maximum_audio_meter_channels> m_audio_peak_levels{};
+    std::atomic<int> m_number_of_audio_channels{};
+    std::array<float, s_maximum_audio_meter_channels> m_displayed_audio_levels_decibels{};
+    // Metadata is only captured whilst something is showing it, see is_capturing_metadata().
+    MetadataRing m_metadata{s_metadata_ring_capacity};
+    bool m_is_metadata_viewer_open{};
+    ImGuiTextFilter m_metadata_filter;
+    // Created the first time we get an interlaced frame to deinterlace.
+    std::unique_ptr<Deinterlacer> m_deinterlacer;
+    // The first field of the last frame is shown straight away, the second half a frame later.
+    bool m_is_second_field_pending{};
+    std::chrono::steady_clock::time_point m_second_field_due_at;
+    std::shared_ptr<ReceiverStatistics> m_receiver_statistics;
+    bool m_is_ptz_window_open{};
+    bool m_is_ptz_gamepad_enabled{};
+    // Whether we last sent the camera any speed other than 0.
+    bool m_is_ptz_moving{};
+    // The PTZ controls are only drawn by update(), so this is how poll() knows if they still are.
+    bool m_has_updated_since_poll{};
+    // The zoom and focus sliders spring back to 0 when let go, so the camera stops.
+    float m_ptz_zoom_speed{};
+    float m_ptz_focus_speed{};
+    int m_ptz_preset{};
+    float m_ptz_preset_recall_speed = 1.0f;
+    bool m_is_ptz_exposure_auto = true;
+    float m_ptz_exposure_level = 0.5f;
+    // Only exists whilst we're recording or keeping frames for replay.
+    std::unique_ptr<SourceCapture> m_source_capture;
+    // Stopped recorders still writing out what they have buffered. We let them finish without waiting on them.
+    std::vector<std::unique_ptr<Recorder>> m_finishing_recorders;
+    std::string m_recording_error;
+    JMP::GL::Texture2D m_replay_texture;
+    int m_replay_texture_width{};
+    int m_replay_texture_height{};
+    bool m_is_replay_window_open{};
+    bool m_is_replay_playing{};
+    // The replay frame being shown, see ReplayBuffer::Frame::serial. Past the end of the buffer means the newest.
+    uint64_t m_replay_serial = std::numeric_limits<uint64_t>::max();
+    std::optional<uint64_t> m_uploaded_replay_serial;
+    std::chrono::steady_clock::time_point m_replay_frame_shown_at;
+    // Created the first time we get a UYVY frame.
+    std::unique_ptr<UYVYConverter> m_uyvy_converter;
 
-    void create_receiver_and_framesync(NDIlib_recv_bandwidth_e);
-    void receive();
+    // Creates a receiver matching our current settings.
+    void create_receiver();
+    bool take_pending_receiver();
+    bool promote_standby_receiver();
+    bool receive(NDIReceiver&, bool force_upload);
+    bool receive_direct(DirectVideoCapture&);
+    void upload(const NDIlib_video_frame_v2_t&);
+    // Uploads a frame, converting it if need be. The texture is given new storage if it isn't already the frame's size.
+    void upload_to_texture(const JMP::GL::Texture2D&, bool is_texture_same_size, const NDIlib_video_frame_v2_t&);
+    bool should_deinterlace(const NDIlib_video_frame_v2_t&);
+    bool render_second_field();
+    bool wants_video_fields() const;
+    // Direct mode only captures video, so it's no good without video.
+    bool can_receive_directly() const { return is_receiving_video(); }
+    void draw_connection_state() const;
+    void draw_frame_pacing();
+    void draw_audio_meters();
+    void draw_recent_metadata() const;
+    void draw_metadata_viewer();
+    bool is_capturing_metadata() const;
+    bool receive_metadata(NDIReceiver&);
+    void draw_receiver_statistics() const;
+    void draw_ptz_controls();
+    void stop_ptz();
+    SourceCapture& source_capture();
+    // Once it's neither recording nor keeping frames for replay, nothing needs the connection.
+    void reap_source_capture_if_unused();
+    ReplayBuffer* replay_buffer() const { return m_source_capture ? m_source_capture->replay_buffer() : nullptr; }
+    void apply_replay_settings();
+    void draw_replay_settings();
+    void draw_replay_window();
+    bool is_steering_with_gamepad() const;
     void set_frame_texture_filtering(GLint);
 };
 }
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "PTZController.h"
+#include <algorithm>
+#include <utility>
+
+namespace Carousel
+{
+PTZController::PTZController(NDIlib_recv_instance_t receiver_instance)
+    : m_receiver_instance(receiver_instance), m_thread([this](std::stop_token stop_token) { run(stop_token); })
+{
+}
+
+PTZController::~PTZController()
+{
+    m_thread.request_stop();
+    m_thread.join();
+}
+
+void PTZController::set_pan_tilt_speed(float pan_speed, float tilt_speed)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_requested_speeds.pan = std::clamp(pan_speed, -1.0f, 1.0f);
+        m_requested_speeds.tilt = std::clamp(tilt_speed, -1.0f, 1.0f);
+    }
+    m_condition.notify_one();
+}
+
+void PTZController::set_zoom_speed(float zoom_speed)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_requested_speeds.zoom = std::clamp(zoom_speed, -1.0f, 1.0f);
+    }
+    m_condition.notify_one();
+}
+
+void PTZController::set_focus_speed(float focus_speed)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_requested_speeds.focus = std::clamp(focus_speed, -1.0f, 1.0f);
+    }
+    m_condition.notify_one();
+}
+
+void PTZController::auto_focus()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_is_auto_focus_pending = true;
+    }
+    m_condition.notify_one();
+}
+
+void PTZController::store_preset(int preset)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_pending_preset = PresetCommand{std::clamp(preset, 0, s_number_of_presets - 1), true, 0.0f};
+    }
+    m_condition.notify_one();
+}
+
+void PTZController::recall_preset(int preset, float speed)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_pending_preset =
+            PresetCommand{std::clamp(preset, 0, s_number_of_presets - 1), false, std::clamp(speed, 0.0f, 1.0f)};
+    }
+    m_condition.notify_one();
+}
+
+void PTZController::set_white_balance(WhiteBalance white_balance)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_pending_white_balance = white_balance;
+    }
+    m_condition.notify_one();
+}
+
+void PTZController::set_exposure_auto()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_pending_exposure = std::optional<float>{};
+    }
+    m_condition.notify_one();
+}
+
+void PTZController::set_exposure_manual(float exposure_level)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_pending_exposure = std::optional<float>{std::clamp(exposure_level, 0.0f, 1.0f)};
+    }
+    m_condition.notify_one();
+}
+
+bool PTZController::has_pending_commands() const
+{
+    return m_requested_speeds.pan != m_sent_speeds.pan || m_requested_speeds.tilt != m_sent_speeds.tilt ||
+           m_requested_speeds.zoom != m_sent_speeds.zoom || m_requested_speeds.focus != m_sent_speeds.focus ||
+           m_is_auto_focus_pending || m_pending_preset || m_pending_white_balance || m_pending_exposure;
+}
+
+void PTZController::run(std::stop_token stop_token)
+{
+    std::unique_lock lock(m_mutex);
+
+    while (m_condition.wait(lock, stop_token, [this] { return has_pending_commands(); }))
+    {
+        auto speeds = m_requested_speeds;
+        auto is_auto_focus_pending = std::exchange(m_is_auto_focus_pending, false);
+        auto preset = std::exchange(m_pending_preset, std::nullopt);
+        auto white_balance = std::exchange(m_pending_white_balance, std::nullopt);
+        auto exposure = std::exchange(m_pending_exposure, std::nullopt);
+
+        // Cameras can be slow to answer, so don't hold up anyone asking for more whilst we send.
+        lock.unlock();
+
+        send_speeds(speeds);
+
+        if (is_auto_focus_pending)
+            NDIlib_recv_ptz_auto_focus(m_receiver_instance);
+
+        if (preset && preset->is_store)
+            NDIlib_recv_ptz_store_preset(m_receiver_instance, preset->preset);
+        else if (preset)
+            NDIlib_recv_ptz_recall_preset(m_receiver_instance, preset->preset, preset->speed);
+
+        if (white_balance)
+        {
+            switch (*white_balance)
+            {
+            case WhiteBalance::Auto:
+                NDIlib_recv_ptz_white_balance_auto(m_receiver_instance);
+                break;
+            case WhiteBalance::Indoor:
+                NDIlib_recv_ptz_white_balance_indoor(m_receiver_instance);
+                break;
+            case WhiteBalance::Outdoor:
+                NDIlib_recv_ptz_white_balance_outdoor(m_receiver_instance);
+                break;
+            case WhiteBalance::OneShot:
+                NDIlib_recv_ptz_white_balance_oneshot(m_receiver_instance);
+                break;
+            }
+        }
+
+        if (exposure && *exposure)
+            NDIlib_recv_ptz_exposure_manual(m_receiver_instance, **exposure);
+        else if (exposure)
+            NDIlib_recv_ptz_exposure_auto(m_receiver_instance);
+
+        lock.lock();
+
+        // Anything asked for until the next tick is folded together, so we send one command per axis at most.
+        m_condition.wait_for(lock, stop_token, s_tick_interval, [] { return false; });
+    }
+
+    lock.unlock();
+
+    // Nobody is left to stop the camera, so don't leave it moving.
+    send_speeds({});
+}
+
+void PTZController::send_speeds(const Speeds& speeds)
+{
+    if (speeds.pan != m_sent_speeds.pan || speeds.tilt != m_sent_speeds.tilt)
+        NDIlib_recv_ptz_pan_tilt_speed(m_receiver_instance, speeds.pan, speeds.tilt);
+
+    if (speeds.zoom != m_sent_speeds.zoom)
+        NDIlib_recv_ptz_zoom_speed(m_receiver_instance, speeds.zoom);
+
+    if (speeds.focus != m_sent_speeds.focus)
+        NDIlib_recv_ptz_focus_speed(m_receiver_instance, speeds.focus);
+
+    m_sent_speeds = speeds;
+}
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include "NDI.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace Carousel
+{
+// Sends PTZ commands to a receiver from its own thread, so a slow camera never holds up drawing. Input can change
+// every frame (or faster), but at most one command per axis is sent each tick, with whatever was asked for last.
+class PTZController
+{
+public:
+    enum class WhiteBalance
+    {
+        Auto,
+        Indoor,
+        Outdoor,
+        // Sets the white balance once from what the camera sees right now.
+        OneShot,
+    };
+
+    explicit PTZController(NDIlib_recv_instance_t);
+    ~PTZController();
+
+    PTZController(const PTZController&) = delete;
+
+    // Speeds are held until they're changed, and are only sent when they do. All of them go from -1.0 to 1.0, with
+    // NDI's directions: positive pans left, tilts up, zooms in and focuses closer.
+    void set_pan_tilt_speed(float pan_speed, float tilt_speed);
+    void set_zoom_speed(float zoom_speed);
+    void set_focus_speed(float focus_speed);
+
+    // Each of these replaces any command of the same kind that hasn't been sent yet.
+    void auto_focus();
+    void store_preset(int preset);
+    void recall_preset(int preset, float speed);
+    void set_white_balance(WhiteBalance);
+    void set_exposure_auto();
+    void set_exposure_manual(float exposure_level);
+
+    static constexpr int s_number_of_presets = 100;
+
+private:
+    static constexpr std::chrono::milliseconds s_tick_interval{50};
+
+    struct Speeds
+    {
+        float pan{};
+        float tilt{};
+        float zoom{};
+        float focus{};
+    };
+
+    struct PresetCommand
+    {
+        int preset{};
+        bool is_store{};
+        float speed{};
+    };
+
+    NDIlib_recv_instance_t m_receiver_instance;
+    std::mutex m_mutex;
+    std::condition_variable_any m_condition;
+    Speeds m_requested_speeds;
+    // Only touched by the thread.
+    Speeds m_sent_speeds;
+    bool m_is_auto_focus_pending{};
+    std::optional<PresetCommand> m_pending_preset;
+    std::optional<WhiteBalance> m_pending_white_balance;
+    // An empty level means auto exposure.
+    std::optional<std::optional<float>> m_pending_exposure;
+    // Declared last, so that it is joined before anything it uses goes away.
+    std::jthread m_thread;
+
+    void run(std::stop_token);
+    bool has_pending_commands() const;
+    void send_speeds(const Speeds&);
+};
+}
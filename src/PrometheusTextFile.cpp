@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "PrometheusTextFile.h"
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+
+namespace Carousel
+{
+void PrometheusTextFile::add_metric(std::string_view name, std::string_view type, std::string_view help)
+{
+    m_metric_name = name;
+
+    m_text.append("# HELP ").append(name).append(" ").append(help).append("\n");
+    m_text.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+void PrometheusTextFile::add_sample(std::string_view source, double value)
+{
+    char formatted_value[32];
+    snprintf(formatted_value, sizeof(formatted_value), "%.17g", value);
+
+    m_text.append(m_metric_name).append("{");
+    add_source_label(source);
+    m_text.append("} ").append(formatted_value).append("\n");
+}
+
+void PrometheusTextFile::add_sample(std::string_view source, int channel, double value)
+{
+    char formatted_value[32];
+    snprintf(formatted_value, sizeof(formatted_value), "%.17g", value);
+
+    m_text.append(m_metric_name).append("{");
+    add_source_label(source);
+    m_text.append(",channel=\"").append(std::to_string(channel)).append("\"} ").append(formatted_value).append("\n");
+}
+
+void PrometheusTextFile::add_source_label(std::string_view source)
+{
+    m_text.append("source=\"");
+
+    // Label values have to escape backslashes, quotes and newlines.
+    for (auto c : source)
+    {
+        if (c == '\\' || c == '"')
+            m_text += '\\';
+        if (c == '\n')
+            m_text += "\\n";
+        else
+            m_text += c;
+    }
+
+    m_text += '"';
+}
+
+bool PrometheusTextFile::write(const std::string& path) const
+{
+    auto temporary_path = path + ".tmp";
+    auto* file = fopen(temporary_path.c_str(), "w");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s for writing metrics\n", temporary_path.c_str());
+        return false;
+    }
+
+    fwrite(m_text.data(), 1, m_text.size(), file);
+
+    if (fclose(file) != 0)
+    {
+        fprintf(stderr, "Failed to write metrics to %s\n", temporary_path.c_str());
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+    if (error)
+    {
+        fprintf(stderr, "Failed to move metrics into %s: %s\n", path.c_str(), error.message().c_str());
+        return false;
+    }
+
+    return true;
+}
+}
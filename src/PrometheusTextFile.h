@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace Carousel
+{
+// Builds up metrics in the Prometheus text format, for something like node_exporter's textfile collector to pick up.
+// Every sample is labelled with the source it's about.
+class PrometheusTextFile
+{
+public:
+    // Samples added after this belong to this metric.
+    void add_metric(std::string_view name, std::string_view type, std::string_view help);
+    void add_sample(std::string_view source, double value);
+    // For metrics with a sample per audio channel.
+    void add_sample(std::string_view source, int channel, double value);
+
+    // Whatever is scraping the file may read it at any moment, so this writes a new one and moves it over the old one,
+    // which replaces it in one go. Returns false (having said why on stderr) if that didn't work.
+    bool write(const std::string& path) const;
+
+private:
+    std::string m_text;
+    std::string m_metric_name;
+
+    void add_source_label(std::string_view source);
+};
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "ReceiverStatistics.h"
+#include <algorithm>
+
+namespace Carousel
+{
+static float drop_rate(int64_t total_frames, int64_t dropped_frames)
+{
+    if (total_frames <= 0)
+        return 0.0f;
+
+    return std::clamp(static_cast<float>(dropped_frames) / static_cast<float>(total_frames), 0.0f, 1.0f);
+}
+
+float ReceiverStatistics::Snapshot::video_drop_rate() const
+{
+    return drop_rate(total_video_frames, dropped_video_frames);
+}
+
+void ReceiverStatistics::sample(const NDIReceiver& receiver)
+{
+    NDIlib_recv_performance_t total_performance{};
+    NDIlib_recv_performance_t dropped_performance{};
+    NDIlib_recv_queue_t queue{};
+
+    NDIlib_recv_get_performance(receiver.receiver_instance(), &total_performance, &dropped_performance);
+    NDIlib_recv_get_queue(receiver.receiver_instance(), &queue);
+
+    std::lock_guard lock(m_mutex);
+
+    auto is_same_receiver = m_sampled_receiver_instance == receiver.receiver_instance();
+    m_sampled_receiver_instance = receiver.receiver_instance();
+
+    if (is_same_receiver)
+    {
+        m_latest.recent_video_drop_rate =
+            drop_rate(total_performance.video_frames - m_latest.total_video_frames,
+                      dropped_performance.video_frames - m_latest.dropped_video_frames);
+        m_latest.recent_audio_drop_rate =
+            drop_rate(total_performance.audio_frames - m_latest.total_audio_frames,
+                      dropped_performance.audio_frames - m_latest.dropped_audio_frames);
+    }
+    else
+    {
+        m_latest.recent_video_drop_rate = 0.0f;
+        m_latest.recent_audio_drop_rate = 0.0f;
+    }
+
+    m_latest.total_video_frames = total_performance.video_frames;
+    m_latest.dropped_video_frames = dropped_performance.video_frames;
+    m_latest.total_audio_frames = total_performance.audio_frames;
+    m_latest.dropped_audio_frames = dropped_performance.audio_frames;
+    m_latest.total_metadata_frames = total_performance.metadata_frames;
+    m_latest.dropped_metadata_frames = dropped_performance.metadata_frames;
+    m_latest.video_queue_depth = queue.video_frames;
+    m_latest.audio_queue_depth = queue.audio_frames;
+    m_latest.metadata_queue_depth = queue.metadata_frames;
+
+    m_latest.video_queue_depth_history[m_next_history_index] = static_cast<float>(queue.video_frames);
+    m_latest.video_drop_rate_history[m_next_history_index] = m_latest.recent_video_drop_rate;
+    m_next_history_index = (m_next_history_index + 1) % s_history_length;
+    if (m_latest.history_size < s_history_length)
+        m_latest.history_size++;
+}
+
+ReceiverStatistics::Snapshot ReceiverStatistics::snapshot() const
+{
+    Snapshot snapshot;
+    int oldest_index{};
+
+    {
+        std::lock_guard lock(m_mutex);
+        snapshot = m_latest;
+        oldest_index = snapshot.history_size < s_history_length ? 0 : m_next_history_index;
+    }
+
+    // Unroll the rings, so the oldest sample comes first.
+    auto rotate = [oldest_index](std::array<float, s_history_length>& history) {
+        std::rotate(history.begin(), history.begin() + oldest_index, history.end());
+    };
+    rotate(snapshot.video_queue_depth_history);
+    rotate(snapshot.video_drop_rate_history);
+
+    return snapshot;
+}
+
+void ReceiverStatistics::add_metrics(PrometheusTextFile& file,
+                                     std::span<const std::pair<std::string, Snapshot>> receiver_statistics)
+{
+    struct Metric
+    {
+        const char* name;
+        const char* type;
+        const char* help;
+        double (*value)(const ReceiverStatistics::Snapshot&);
+    };
+
+    static constexpr Metric metrics[] = {
+        {"carousel_receiver_video_frames_total", "counter", "Video frames received.",
+         [](const ReceiverStatistics::Snapshot& s) { return static_cast<double>(s.total_video_frames); }},
+        {"carousel_receiver_video_frames_dropped_total", "counter", "Video frames dropped.",
+         [](const ReceiverStatistics::Snapshot& s) { return static_cast<double>(s.dropped_video_frames); }},
+        {"carousel_receiver_audio_frames_total", "counter", "Audio frames received.",
+         [](const ReceiverStatistics::Snapshot& s) { return static_cast<double>(s.total_audio_frames); }},
+        {"carousel_receiver_audio_frames_dropped_total", "counter", "Audio frames dropped.",
+         [](const ReceiverStatistics::Snapshot& s) { return static_cast<double>(s.dropped_audio_frames); }},
+        {"carousel_receiver_metadata_frames_total", "counter", "Metadata frames received.",
+         [](const ReceiverStatistics::Snapshot& s) { return static_cast<double>(s.total_metadata_frames); }},
+        {"carousel_receiver_metadata_frames_dropped_total", "counter", "Metadata frames dropped.",
+         [](const ReceiverStatistics::Snapshot& s) { return static_cast<double>(s.dropped_metadata_frames); }},
+        {"carousel_receiver_video_drop_rate", "gauge", "Fraction of video frames dropped since the last sample.",
+         [](const ReceiverStatistics::Snapshot& s) { return static_cast<double>(s.recent_video_drop_rate); }},
+        {"carousel_receiver_audio_drop_rate", "gauge", "Fraction of audio frames dropped since the last sample.",
+         [](const ReceiverStatistics::Snapshot& s) { return static_cast<double>(s.recent_audio_drop_rate); }},
+        {"carousel_receiver_video_queue_depth", "gauge", "Video frames waiting to be captured.",
+         [](const ReceiverStatistics::Snapshot& s) { return static_cast<double>(s.video_queue_depth); }},
+        {"carousel_receiver_audio_queue_depth", "gauge", "Audio frames waiting to be captured.",
+         [](const ReceiverStatistics::Snapshot& s) { return static_cast<double>(s.audio_queue_depth); }},
+    };
+
+    for (auto& metric : metrics)
+    {
+        file.add_metric(metric.name, metric.type, metric.help);
+
+        for (auto& [name, statistics] : receiver_statistics)
+            file.add_sample(name, metric.value(statistics));
+    }
+}
+}
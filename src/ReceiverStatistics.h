@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include "NDI.h"
+#include "NDIReceiver.h"
+#include "PrometheusTextFile.h"
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <utility>
+
+namespace Carousel
+{
+// What NDI tells us about a receiver's frame counts and queues. This is sampled from a background thread and read from
+// the render thread, so everything is handed out as a copy.
+class ReceiverStatistics
+{
+public:
+    // At one sample a second, this is the last minute.
+    static constexpr int s_history_length = 60;
+
+    struct Snapshot
+    {
+        int64_t total_video_frames{};
+        int64_t dropped_video_frames{};
+        int64_t total_audio_frames{};
+        int64_t dropped_audio_frames{};
+        int64_t total_metadata_frames{};
+        int64_t dropped_metadata_frames{};
+        int video_queue_depth{};
+        int audio_queue_depth{};
+        int metadata_queue_depth{};
+        // Fraction of frames dropped between the last two samples.
+        float recent_video_drop_rate{};
+        float recent_audio_drop_rate{};
+        // Oldest first. Only the first history_size entries are meaningful.
+        std::array<float, s_history_length> video_queue_depth_history{};
+        std::array<float, s_history_length> video_drop_rate_history{};
+        int history_size{};
+
+        float video_drop_rate() const;
+    };
+
+    // The source's name is kept with its statistics, so they can still be exported after its window has gone.
+    explicit ReceiverStatistics(std::string source_name = {}) : m_source_name(std::move(source_name)) {}
+
+    const std::string& source_name() const { return m_source_name; }
+    // Asks NDI for the receiver's current numbers. The receiver must not be destroyed whilst this is running.
+    void sample(const NDIReceiver&);
+    Snapshot snapshot() const;
+
+    // Adds a metric for each of a snapshot's numbers, with a sample for each of the given sources.
+    static void add_metrics(PrometheusTextFile&, std::span<const std::pair<std::string, Snapshot>>);
+
+private:
+    std::string m_source_name;
+    mutable std::mutex m_mutex;
+    Snapshot m_latest;
+    // Where the next history entry goes, treating the history arrays as rings.
+    int m_next_history_index{};
+    // The counters start over with every receiver, so we mustn't take a difference across receivers.
+    NDIlib_recv_instance_t m_sampled_receiver_instance{};
+};
+}
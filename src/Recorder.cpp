@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "Recorder.h"
+#include <cerrno>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+namespace Carousel
+{
+static std::filesystem::path path_with_extension(std::filesystem::path base_path, const char* extension)
+{
+    base_path += extension;
+    return base_path;
+}
+
+Recorder::Recorder(std::filesystem::path base_path)
+    : m_base_path(std::move(base_path)),
+      m_video_writer(path_with_extension(m_base_path, ".video"), s_video_chunk_size, s_number_of_video_chunks),
+      m_audio_writer(path_with_extension(m_base_path, ".audio"), s_audio_chunk_size, s_number_of_audio_chunks),
+      m_pending_index_entries(std::make_unique<IndexEntry[]>(s_maximum_pending_index_entries))
+{
+    auto index_path = path_with_extension(m_base_path, ".index");
+    if (!(m_index_file = fopen(index_path.c_str(), "w")))
+        throw std::runtime_error("Failed to create " + index_path.string() + ": " + strerror(errno));
+
+    fprintf(m_index_file, "# video offset size timecode timestamp width height line_stride fourcc frame_rate "
+                          "frame_format_type\n");
+    fprintf(m_index_file, "# audio offset size timecode sample_rate channels samples\n");
+
+    m_thread = std::jthread([this](std::stop_token stop_token) { run(stop_token); });
+}
+
+Recorder::~Recorder()
+{
+    m_thread.request_stop();
+    m_thread.join();
+
+    fclose(m_index_file);
+}
+
+void Recorder::record_video(const NDIlib_video_frame_v2_t& video_frame)
+{
+    auto size = video_frame_data_size(video_frame);
+    std::optional<uint64_t> offset;
+    if (!has_room_for_index_entry() || !(offset = m_video_writer.append(video_frame.p_data, size)))
+    {
+        m_number_of_dropped_video_frames++;
+        return;
+    }
+
+    m_number_of_recorded_video_frames++;
+
+    IndexEntry entry;
+    entry.is_video = true;
+    entry.offset = *offset;
+    entry.size = size;
+    entry.timecode = video_frame.timecode;
+    entry.timestamp = video_frame.timestamp;
+    entry.width = video_frame.xres;
+    entry.height = video_frame.yres;
+    entry.line_stride = video_frame.line_stride_in_bytes;
+    entry.fourcc = video_frame.FourCC;
+    entry.frame_rate_N = video_frame.frame_rate_N;
+    entry.frame_rate_D = video_frame.frame_rate_D;
+    entry.frame_format_type = video_frame.frame_format_type;
+    add_index_entry(entry);
+}
+
+void Recorder::record_audio(const NDIlib_audio_frame_interleaved_32f_t& audio_frame)
+{
+    auto size = static_cast<size_t>(audio_frame.no_samples) * static_cast<size_t>(audio_frame.no_channels) *
+                sizeof(float);
+    std::optional<uint64_t> offset;
+    if (!has_room_for_index_entry() || !(offset = m_audio_writer.append(audio_frame.p_data, size)))
+    {
+        m_number_of_dropped_audio_frames++;
+        return;
+    }
+
+    IndexEntry entry;
+    entry.offset = *offset;
+    entry.size = size;
+    entry.timecode = audio_frame.timecode;
+    entry.sample_rate = audio_frame.sample_rate;
+    entry.number_of_channels = audio_frame.no_channels;
+    entry.number_of_samples = audio_frame.no_samples;
+    add_index_entry(entry);
+}
+
+uint64_t Recorder::number_of_bytes_written() const
+{
+    return m_video_writer.number_of_bytes_written() + m_audio_writer.number_of_bytes_written();
+}
+
+bool Recorder::has_room_for_index_entry()
+{
+    std::lock_guard lock(m_mutex);
+    return m_number_of_pending_index_entries < s_maximum_pending_index_entries;
+}
+
+void Recorder::add_index_entry(const IndexEntry& entry)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_pending_index_entries[(m_first_pending_index_entry + m_number_of_pending_index_entries) %
+                                s_maximum_pending_index_entries] = entry;
+        m_number_of_pending_index_entries++;
+    }
+    m_condition.notify_one();
+}
+
+size_t Recorder::take_pending_index_entries(IndexEntry* index_entries)
+{
+    std::lock_guard lock(m_mutex);
+
+    auto number_of_entries = static_cast<size_t>(m_number_of_pending_index_entries);
+    for (size_t i = 0; i < number_of_entries; i++)
+        index_entries[i] = m_pending_index_entries[(m_first_pending_index_entry + i) % s_maximum_pending_index_entries];
+
+    m_first_pending_index_entry += number_of_entries;
+    m_number_of_pending_index_entries = 0;
+    return number_of_entries;
+}
+
+void Recorder::run(std::stop_token stop_token)
+{
+    // The entries are written out after letting go of the ring, so the capture thread never waits on the index file.
+    auto index_entries = std::make_unique<IndexEntry[]>(s_maximum_pending_index_entries);
+
+    while (!stop_token.stop_requested())
+    {
+        {
+            std::unique_lock lock(m_mutex);
+            m_condition.wait(lock, stop_token, [this] { return m_number_of_pending_index_entries > 0; });
+        }
+
+        auto number_of_entries = take_pending_index_entries(index_entries.get());
+
+        // Every append comes with an index entry, so we're woken up for any chunk that might have filled.
+        m_video_writer.write_full_chunks();
+        m_audio_writer.write_full_chunks();
+
+        write_index_entries(index_entries.get(), number_of_entries);
+    }
+
+    // Whoever stopped us isn't recording anything else, so whatever is left is all there is.
+    m_video_writer.finish();
+    m_audio_writer.finish();
+
+    write_index_entries(index_entries.get(), take_pending_index_entries(index_entries.get()));
+    fflush(m_index_file);
+
+    m_is_finished = true;
+}
+
+void Recorder::write_index_entries(const IndexEntry* index_entries, size_t number_of_entries)
+{
+    for (size_t i = 0; i < number_of_entries; i++)
+    {
+        auto& entry = index_entries[i];
+
+        if (entry.is_video)
+        {
+            char fourcc[] = {static_cast<char>(entry.fourcc & 0xFF), static_cast<char>((entry.fourcc >> 8) & 0xFF),
+                             static_cast<char>((entry.fourcc >> 16) & 0xFF),
+                             static_cast<char>((entry.fourcc >> 24) & 0xFF), '\0'};
+
+            fprintf(m_index_file, "video %llu %zu %lld %lld %d %d %d %s %d/%d %d\n",
+                    static_cast<unsigned long long>(entry.offset), entry.size, static_cast<long long>(entry.timecode),
+                    static_cast<long long>(entry.timestamp), entry.width, entry.height, entry.line_stride, fourcc,
+                    entry.frame_rate_N, entry.frame_rate_D, static_cast<int>(entry.frame_format_type));
+        }
+        else
+        {
+            fprintf(m_index_file, "audio %llu %zu %lld %d %d %d\n", static_cast<unsigned long long>(entry.offset),
+                    entry.size, static_cast<long long>(entry.timecode), entry.sample_rate, entry.number_of_channels,
+                    entry.number_of_samples);
+        }
+    }
+}
+}
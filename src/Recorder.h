@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include "DirectFileWriter.h"
+#include "NDI.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace Carousel
+{
+// Records a source's video and audio to disk for looking back at later. Frames are copied into DirectFileWriter's
+// buffers by whoever records them (see SourceCapture), and written out by our own thread.
+//
+// The recording is three files: base_path with .video and .audio appended hold the raw frames and samples back to back,
+// and .index is a text file describing each frame and where it is. Both are exactly as the source sent them, apart from
+// audio being interleaved (as 32-bit float) rather than planar.
+class Recorder
+{
+public:
+    explicit Recorder(std::filesystem::path base_path);
+    ~Recorder();
+
+    Recorder(const Recorder&) = delete;
+
+    // Both of these are called from the capture thread, with each frame as it arrives. Frames are copied, so they can
+    // be freed straight after. Neither allocates or waits on the disk.
+    void record_video(const NDIlib_video_frame_v2_t&);
+    void record_audio(const NDIlib_audio_frame_interleaved_32f_t&);
+
+    // Stops taking frames and writes out whatever is left, without waiting for it to be done. Nothing may be recorded
+    // after this.
+    void stop() { m_thread.request_stop(); }
+    // Whether everything has been written after stop().
+    bool is_finished() const { return m_is_finished; }
+
+    const std::filesystem::path& base_path() const { return m_base_path; }
+    uint64_t number_of_recorded_video_frames() const { return m_number_of_recorded_video_frames; }
+    // Frames the disk couldn't keep up with.
+    uint64_t number_of_dropped_video_frames() const { return m_number_of_dropped_video_frames; }
+    uint64_t number_of_dropped_audio_frames() const { return m_number_of_dropped_audio_frames; }
+    uint64_t number_of_bytes_written() const;
+    bool has_failed() const { return m_video_writer.has_failed() || m_audio_writer.has_failed(); }
+
+private:
+    // This is all allocated for as long as we're recording. It buffers about a quarter of a second of 1080p60 RGBA
+    // (twice that in UYVY) for the disk to catch up with, before frames are dropped.
+    static constexpr size_t s_video_chunk_size = 8 * 1024 * 1024;
+    static constexpr size_t s_number_of_video_chunks = 16;
+    static constexpr size_t s_audio_chunk_size = 1024 * 1024;
+    static constexpr size_t s_number_of_audio_chunks = 4;
+    // Several seconds of video and audio frames, for if the index file falls behind.
+    static constexpr size_t s_maximum_pending_index_entries = 1024;
+
+    struct IndexEntry
+    {
+        bool is_video{};
+        uint64_t offset{};
+        size_t size{};
+        int64_t timecode{};
+        int64_t timestamp{};
+        int width{};
+        int height{};
+        int line_stride{};
+        NDIlib_FourCC_video_type_e fourcc{};
+        int frame_rate_N{};
+        int frame_rate_D{};
+        NDIlib_frame_format_type_e frame_format_type{};
+        int sample_rate{};
+        int number_of_channels{};
+        int number_of_samples{};
+    };
+
+    std::filesystem::path m_base_path;
+    DirectFileWriter m_video_writer;
+    DirectFileWriter m_audio_writer;
+    std::FILE* m_index_file{};
+    std::mutex m_mutex;
+    std::condition_variable_any m_condition;
+    // A ring, preallocated so that recording a frame never allocates.
+    std::unique_ptr<IndexEntry[]> m_pending_index_entries;
+    uint64_t m_first_pending_index_entry{};
+    uint64_t m_number_of_pending_index_entries{};
+    std::atomic<uint64_t> m_number_of_recorded_video_frames{};
+    std::atomic<uint64_t> m_number_of_dropped_video_frames{};
+    std::atomic<uint64_t> m_number_of_dropped_audio_frames{};
+    std::atomic<bool> m_is_finished{};
+    // Declared last, so that it is joined before anything it uses goes away.
+    std::jthread m_thread;
+
+    void run(std::stop_token);
+    // Only the capture thread adds entries, so if there's room beforehand, there still is by the time it adds one.
+    bool has_room_for_index_entry();
+    void add_index_entry(const IndexEntry&);
+    // Moves the pending entries out, returning how many there were.
+    size_t take_pending_index_entries(IndexEntry*);
+    void write_index_entries(const IndexEntry*, size_t number_of_entries);
+};
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "ReplayBuffer.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Carousel
+{
+ReplayBuffer::ReplayBuffer(size_t budget_bytes, std::chrono::steady_clock::duration maximum_duration)
+    : m_data(std::make_unique_for_overwrite<uint8_t[]>(budget_bytes)), m_budget_bytes(budget_bytes),
+      m_maximum_duration(maximum_duration)
+{
+    // Until it's written to, the OS may not have found the memory for it at all, in which case a budget bigger than we
+    // can have would only fail once the buffer fills up. Writing it all now means that happens here instead.
+    memset(m_data.get(), 0, budget_bytes);
+}
+
+void ReplayBuffer::push(const NDIlib_video_frame_v2_t& video_frame, std::chrono::steady_clock::time_point received_at)
+{
+    auto size = video_frame_data_size(video_frame);
+    if (!video_frame.p_data || size == 0)
+        return;
+
+    if (size > m_budget_bytes)
+    {
+        m_number_of_oversized_frames++;
+        return;
+    }
+
+    auto offset = m_write_offset;
+    if (offset + size > m_budget_bytes)
+    {
+        // It doesn't fit before the end, so we wrap around to the start. Whatever is left between here and the end is
+        // older than anything at the start, so it has to go first.
+        while (!m_frames.empty() && offset_of(m_frames.front()) >= offset)
+            evict_oldest_frame();
+        offset = 0;
+    }
+
+    // Frames are laid out oldest first from where we're writing, so anything in the way is the oldest we have.
+    while (!m_frames.empty() && offset_of(m_frames.front()) < offset + size &&
+           offset_of(m_frames.front()) + video_frame_data_size(m_frames.front().video_frame) > offset)
+    {
+        evict_oldest_frame();
+    }
+
+    auto& frame = m_frames.emplace_back();
+    frame.video_frame = video_frame;
+    frame.video_frame.p_data = m_data.get() + offset;
+    frame.video_frame.p_metadata = nullptr;
+    frame.received_at = received_at;
+    frame.serial = m_next_serial++;
+    memcpy(frame.video_frame.p_data, video_frame.p_data, size);
+
+    m_write_offset = offset + size;
+    m_used_bytes += size;
+
+    while (m_frames.size() > 1 && received_at - m_frames.front().received_at > m_maximum_duration)
+        evict_oldest_frame();
+}
+
+void ReplayBuffer::clear()
+{
+    m_frames.clear();
+    m_write_offset = 0;
+    m_used_bytes = 0;
+}
+
+size_t ReplayBuffer::index_of(uint64_t serial) const
+{
+    if (m_frames.empty() || serial <= m_frames.front().serial)
+        return 0;
+
+    // Serials are consecutive, since frames only ever leave from the front.
+    return std::min(static_cast<size_t>(serial - m_frames.front().serial), m_frames.size() - 1);
+}
+
+std::chrono::steady_clock::duration ReplayBuffer::duration() const
+{
+    if (m_frames.empty())
+        return {};
+
+    return m_frames.back().received_at - m_frames.front().received_at;
+}
+
+size_t ReplayBuffer::offset_of(const Frame& frame) const
+{
+    return static_cast<size_t>(frame.video_frame.p_data - m_data.get());
+}
+
+void ReplayBuffer::evict_oldest_frame()
+{
+    m_used_bytes -= video_frame_data_size(m_frames.front().video_frame);
+    m_frames.pop_front();
+}
+}
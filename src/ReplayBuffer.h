@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include "NDI.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+namespace Carousel
+{
+// Keeps copies of the last few seconds of a source's frames, as received (so UYVY frames take half the memory of RGBA
+// ones), for replaying. The memory for frames is allocated (and touched, so it's really ours) up front, and they're
+// packed into it back to back, so we never use more than the budget, however big the frames are.
+//
+// Frames are timed by when they arrived rather than by their timecodes, which senders are free to leave constant, or
+// wrap at midnight.
+class ReplayBuffer
+{
+public:
+    struct Frame
+    {
+        // p_data points into the buffer, and is only good until the frame is evicted.
+        NDIlib_video_frame_v2_t video_frame{};
+        std::chrono::steady_clock::time_point received_at;
+        // Counts up from the first frame ever pushed, so a frame can be found again after older ones are evicted.
+        uint64_t serial{};
+    };
+
+    // Throws std::bad_alloc if the budget can't be allocated.
+    ReplayBuffer(size_t budget_bytes, std::chrono::steady_clock::duration maximum_duration);
+
+    ReplayBuffer(const ReplayBuffer&) = delete;
+
+    // Copies the frame in, evicting the oldest frames to make room, along with any that arrived more than
+    // maximum_duration before it.
+    void push(const NDIlib_video_frame_v2_t&, std::chrono::steady_clock::time_point received_at);
+    void clear();
+
+    size_t size() const { return m_frames.size(); }
+    bool empty() const { return m_frames.empty(); }
+    // Zero is the oldest frame.
+    const Frame& operator[](size_t index) const { return m_frames[index]; }
+    // The index of the frame with the given serial, or of the closest one we still have.
+    size_t index_of(uint64_t serial) const;
+
+    size_t budget_bytes() const { return m_budget_bytes; }
+    size_t used_bytes() const { return m_used_bytes; }
+    void set_maximum_duration(std::chrono::steady_clock::duration maximum_duration)
+    {
+        m_maximum_duration = maximum_duration;
+    }
+    // From the oldest frame arriving to the newest.
+    std::chrono::steady_clock::duration duration() const;
+    // Frames that didn't fit in the whole budget by themselves.
+    uint64_t number_of_oversized_frames() const { return m_number_of_oversized_frames; }
+
+private:
+    std::unique_ptr<uint8_t[]> m_data;
+    size_t m_budget_bytes;
+    std::chrono::steady_clock::duration m_maximum_duration;
+    std::deque<Frame> m_frames;
+    // Where the next frame goes, if it fits before the end.
+    size_t m_write_offset{};
+    size_t m_used_bytes{};
+    uint64_t m_next_serial{};
+    uint64_t m_number_of_oversized_frames{};
+
+    size_t offset_of(const Frame&) const;
+    void evict_oldest_frame();
+};
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "ShaderProgram.h"
+#include <JMP/ScopeGuard.h>
+#include <stdexcept>
+#include <string>
+
+namespace Carousel
+{
+static GLuint compile_shader(GLenum type, std::string_view source)
+{
+    auto shader = glCreateShader(type);
+    auto source_data = source.data();
+    auto source_length = static_cast<GLint>(source.size());
+    glShaderSource(shader, 1, &source_data, &source_length);
+    glCompileShader(shader);
+
+    GLint was_compiled{};
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &was_compiled);
+
+    if (!was_compiled)
+    {
+        GLint info_log_length{};
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &info_log_length);
+        std::string info_log(info_log_length, '\0');
+        glGetShaderInfoLog(shader, info_log_length, nullptr, info_log.data());
+        glDeleteShader(shader);
+
+        throw std::runtime_error("Failed to compile shader: " + info_log);
+    }
+
+    return shader;
+}
+
+ShaderProgram::ShaderProgram(std::string_view vertex_source, std::string_view fragment_source)
+{
+    auto vertex_shader = compile_shader(GL_VERTEX_SHADER, vertex_source);
+    JMP::ScopeGuard delete_vertex_shader = [vertex_shader]() { glDeleteShader(vertex_shader); };
+
+    auto fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fragment_source);
+    JMP::ScopeGuard delete_fragment_shader = [fragment_shader]() { glDeleteShader(fragment_shader); };
+
+    m_name = glCreateProgram();
+    glAttachShader(m_name, vertex_shader);
+    glAttachShader(m_name, fragment_shader);
+    glLinkProgram(m_name);
+    glDetachShader(m_name, vertex_shader);
+    glDetachShader(m_name, fragment_shader);
+
+    GLint was_linked{};
+    glGetProgramiv(m_name, GL_LINK_STATUS, &was_linked);
+
+    if (!was_linked)
+    {
+        GLint info_log_length{};
+        glGetProgramiv(m_name, GL_INFO_LOG_LENGTH, &info_log_length);
+        std::string info_log(info_log_length, '\0');
+        glGetProgramInfoLog(m_name, info_log_length, nullptr, info_log.data());
+        glDeleteProgram(m_name);
+        m_name = 0;
+
+        throw std::runtime_error("Failed to link shader program: " + info_log);
+    }
+}
+
+ShaderProgram::~ShaderProgram()
+{
+    if (m_name)
+        glDeleteProgram(m_name);
+}
+}
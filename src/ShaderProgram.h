@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <glad/gl.h>
+#include <string_view>
+
+namespace Carousel
+{
+class ShaderProgram
+{
+public:
+    ShaderProgram(std::string_view vertex_source, std::string_view fragment_source);
+    ~ShaderProgram();
+
+    ShaderProgram(const ShaderProgram&) = delete;
+
+    GLuint name() const { return m_name; }
+    GLint uniform_location(const char* uniform_name) const { return glGetUniformLocation(m_name, uniform_name); }
+
+private:
+    GLuint m_name{};
+};
+}
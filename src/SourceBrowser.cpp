@@ -0,0 +1,333 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "SourceBrowser.h"
+#include <algorithm>
+#include <cstdio>
+#include <imgui/imgui.h>
+#include <utility>
+
+namespace Carousel
+{
+SourceBrowser::SourceBrowser(NDIReceiverReaper& receiver_reaper) : m_receiver_reaper(receiver_reaper)
+{
+    for (size_t i = 0; i < s_number_of_workers; i++)
+        m_workers.emplace_back([this](std::stop_token stop_token) { run(stop_token); });
+}
+
+SourceBrowser::~SourceBrowser()
+{
+    m_workers.clear();
+
+    for (auto& thumbnail : m_thumbnails)
+    {
+        if (thumbnail->receiver)
+            m_receiver_reaper.reap(std::move(thumbnail->receiver));
+        if (thumbnail->texture)
+            m_free_textures.push_back(thumbnail->texture);
+    }
+
+    glDeleteTextures(static_cast<GLsizei>(m_free_textures.size()), m_free_textures.data());
+}
+
+void SourceBrowser::update(std::span<const NDIlib_source_t> sources)
+{
+    std::lock_guard lock(m_mutex);
+
+    for (auto& source : sources)
+    {
+        if (std::none_of(m_thumbnails.begin(), m_thumbnails.end(),
+                         [&source](const auto& thumbnail) { return thumbnail->source == source; }))
+        {
+            m_thumbnails.push_back(std::make_shared<Thumbnail>(NDISourceWindow::Source(source)));
+            m_condition.notify_one();
+        }
+    }
+
+    for (auto thumbnail_iterator = m_thumbnails.begin(); thumbnail_iterator != m_thumbnails.end();)
+    {
+        auto& thumbnail = *thumbnail_iterator;
+        if (std::any_of(sources.begin(), sources.end(),
+                        [&thumbnail](const auto& source) { return thumbnail->source == source; }))
+        {
+            thumbnail_iterator++;
+            continue;
+        }
+
+        remove_thumbnail(thumbnail);
+        thumbnail_iterator = m_thumbnails.erase(thumbnail_iterator);
+    }
+
+    for (auto& thumbnail : m_thumbnails)
+    {
+        if (!thumbnail->has_new_pixels)
+            continue;
+
+        if (!thumbnail->texture)
+            thumbnail->texture = take_texture();
+
+        glBindTexture(GL_TEXTURE_2D, thumbnail->texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, s_thumbnail_width, s_thumbnail_height, GL_RGBA, GL_UNSIGNED_BYTE,
+                        thumbnail->pixels.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        thumbnail->has_new_pixels = false;
+    }
+}
+
+std::optional<NDISourceWindow::Source> SourceBrowser::draw(bool* is_open)
+{
+    std::optional<NDISourceWindow::Source> clicked_source;
+
+    ImGui::SetNextWindowSize(ImVec2(4 * (s_thumbnail_width + s_thumbnail_spacing), 3 * s_thumbnail_height),
+                             ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Source Browser", is_open))
+    {
+        ImGui::End();
+        return {};
+    }
+
+    if (m_thumbnails.empty())
+        ImGui::TextDisabled("No sources found");
+
+    // Only we change the list of thumbnails, and only their textures are read here, so we don't need the lock.
+    ImVec2 thumbnail_size(s_thumbnail_width, s_thumbnail_height);
+    auto columns = std::max(1, static_cast<int>((ImGui::GetContentRegionAvail().x + s_thumbnail_spacing) /
+                                                (thumbnail_size.x + s_thumbnail_spacing)));
+    auto* draw_list = ImGui::GetWindowDrawList();
+
+    for (size_t i = 0; i < m_thumbnails.size(); i++)
+    {
+        auto& thumbnail = *m_thumbnails[i];
+        auto name = thumbnail.source.name();
+        ImGui::PushID(static_cast<int>(i));
+
+        auto is_clicked = thumbnail.texture
+                              ? ImGui::ImageButton("##Thumbnail", reinterpret_cast<ImTextureID>(thumbnail.texture),
+                                                   thumbnail_size)
+                              : ImGui::Button("##Thumbnail", thumbnail_size);
+        if (is_clicked)
+            clicked_source = thumbnail.source;
+
+        auto label_position = ImGui::GetItemRectMin();
+        auto label_size = ImGui::CalcTextSize(name.data(), name.data() + name.size());
+        draw_list->AddRectFilled(label_position,
+                                 ImVec2(label_position.x + label_size.x, label_position.y + label_size.y),
+                                 IM_COL32(0, 0, 0, 160));
+        draw_list->AddText(label_position, IM_COL32(255, 255, 255, 255), name.data(), name.data() + name.size());
+
+        ImGui::PopID();
+
+        if ((i + 1) % columns != 0)
+            ImGui::SameLine(0.0f, s_thumbnail_spacing);
+    }
+
+    ImGui::End();
+    return clicked_source;
+}
+
+GLuint SourceBrowser::take_texture()
+{
+    if (!m_free_textures.empty())
+    {
+        auto texture = m_free_textures.back();
+        m_free_textures.pop_back();
+        return texture;
+    }
+
+    // Every thumbnail is the same size, so any of them can be reused for any source.
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, s_thumbnail_width, s_thumbnail_height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                 nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+void SourceBrowser::remove_thumbnail(const std::shared_ptr<Thumbnail>& thumbnail)
+{
+    if (thumbnail->texture)
+    {
+        m_free_textures.push_back(thumbnail->texture);
+        thumbnail->texture = 0;
+    }
+
+    // Whoever is working on it will get rid of the receiver once they're done.
+    thumbnail->is_removed = true;
+    if (!thumbnail->is_busy && thumbnail->receiver)
+    {
+        m_receiver_reaper.reap(std::move(thumbnail->receiver));
+        m_number_of_receivers--;
+    }
+}
+
+void SourceBrowser::run(std::stop_token stop_token)
+{
+    while (!stop_token.stop_requested())
+    {
+        std::shared_ptr<Thumbnail> thumbnail;
+
+        {
+            std::unique_lock lock(m_mutex);
+
+            auto now = std::chrono::steady_clock::now();
+            auto next_wake_time = now + s_refresh_interval;
+            if (!(thumbnail = next_thumbnail_to_work_on(now, next_wake_time)))
+            {
+                m_condition.wait_until(lock, stop_token, next_wake_time, []() { return false; });
+                continue;
+            }
+
+            thumbnail->is_busy = true;
+        }
+
+        if (!thumbnail->receiver)
+        {
+            try
+            {
+                auto ndi_source = thumbnail->source.to_ndi_source();
+                // RGBA is simpler to scale down than UYVY.
+                thumbnail->receiver = std::make_unique<NDIReceiver>(ndi_source, NDIlib_recv_bandwidth_lowest,
+                                                                    NDIlib_recv_color_format_RGBX_RGBA);
+            }
+            catch (const std::exception& ex)
+            {
+                fprintf(stderr, "Failed to create thumbnail receiver for %.*s: %s\n",
+                        static_cast<int>(thumbnail->source.name().size()), thumbnail->source.name().data(),
+                        ex.what());
+            }
+        }
+        else
+            capture_thumbnail(*thumbnail);
+
+        std::lock_guard lock(m_mutex);
+        thumbnail->is_busy = false;
+
+        if (!thumbnail->receiver)
+        {
+            // We counted it before trying to open it.
+            m_number_of_receivers--;
+            continue;
+        }
+
+        // Once we have something to show for this source, let another source that has nothing yet take its turn. That's
+        // only worth doing when we're out of receivers, otherwise the waiting source can just open its own.
+        auto is_source_waiting = std::any_of(m_thumbnails.begin(), m_thumbnails.end(), [](const auto& other) {
+            return !other->receiver && !other->is_busy;
+        });
+
+        if (thumbnail->is_removed || (thumbnail->has_captured_since_opened && is_source_waiting &&
+                                      m_number_of_receivers >= s_maximum_number_of_receivers))
+        {
+            m_receiver_reaper.reap(std::move(thumbnail->receiver));
+            thumbnail->has_captured_since_opened = false;
+            m_number_of_receivers--;
+            m_condition.notify_one();
+        }
+    }
+}
+
+std::shared_ptr<SourceBrowser::Thumbnail>
+SourceBrowser::next_thumbnail_to_work_on(std::chrono::steady_clock::time_point now,
+                                         std::chrono::steady_clock::time_point& next_wake_time)
+{
+    std::shared_ptr<Thumbnail> source_to_open;
+
+    for (auto& thumbnail : m_thumbnails)
+    {
+        if (thumbnail->is_busy)
+            continue;
+
+        if (thumbnail->next_refresh_time > now)
+        {
+            next_wake_time = std::min(next_wake_time, thumbnail->next_refresh_time);
+            continue;
+        }
+
+        if (thumbnail->receiver)
+        {
+            thumbnail->next_refresh_time = now + s_refresh_interval;
+            return thumbnail;
+        }
+
+        // Sources that have gone the longest without a thumbnail (or never had one) are first in line for a receiver.
+        if (!source_to_open || thumbnail->last_capture_time < source_to_open->last_capture_time)
+            source_to_open = thumbnail;
+    }
+
+    if (!source_to_open || m_number_of_receivers >= s_maximum_number_of_receivers)
+        return nullptr;
+
+    // It takes a moment to connect, so there's no point trying to capture from it straight away.
+    source_to_open->next_refresh_time = now + s_refresh_interval;
+    m_number_of_receivers++;
+    return source_to_open;
+}
+
+void SourceBrowser::capture_thumbnail(Thumbnail& thumbnail)
+{
+    auto* framesync_instance = thumbnail.receiver->framesync_instance();
+
+    NDIlib_video_frame_v2_t video_frame{};
+    NDIlib_framesync_capture_video(framesync_instance, &video_frame, NDIlib_frame_format_type_progressive);
+
+    auto is_bgra = video_frame.FourCC == NDIlib_FourCC_video_type_BGRA ||
+                   video_frame.FourCC == NDIlib_FourCC_video_type_BGRX;
+    auto is_rgba = video_frame.FourCC == NDIlib_FourCC_video_type_RGBA ||
+                   video_frame.FourCC == NDIlib_FourCC_video_type_RGBX;
+
+    if (!video_frame.p_data || video_frame.xres <= 0 || video_frame.yres <= 0 || (!is_bgra && !is_rgba))
+    {
+        NDIlib_framesync_free_video(framesync_instance, &video_frame);
+        return;
+    }
+
+    // Letterboxed into the thumbnail, keeping the frame's aspect ratio.
+    auto aspect_ratio = video_frame.picture_aspect_ratio > 0.0f
+                            ? video_frame.picture_aspect_ratio
+                            : static_cast<float>(video_frame.xres) / static_cast<float>(video_frame.yres);
+    auto width = s_thumbnail_width;
+    auto height = s_thumbnail_height;
+    if (aspect_ratio > static_cast<float>(s_thumbnail_width) / static_cast<float>(s_thumbnail_height))
+        height = std::max(1, static_cast<int>(static_cast<float>(s_thumbnail_width) / aspect_ratio));
+    else
+        width = std::max(1, static_cast<int>(static_cast<float>(s_thumbnail_height) * aspect_ratio));
+    auto x_offset = (s_thumbnail_width - width) / 2;
+    auto y_offset = (s_thumbnail_height - height) / 2;
+
+    std::vector<uint8_t> pixels(static_cast<size_t>(s_thumbnail_width) * s_thumbnail_height * 4);
+    for (size_t i = 3; i < pixels.size(); i += 4)
+        pixels[i] = 255;
+
+    // Nearest neighbour is plenty for something this small, and we do it once a second.
+    for (auto y = 0; y < height; y++)
+    {
+        auto* source_row =
+            video_frame.p_data + static_cast<size_t>(y * video_frame.yres / height) * video_frame.line_stride_in_bytes;
+        auto* destination = &pixels[(static_cast<size_t>(y + y_offset) * s_thumbnail_width + x_offset) * 4];
+
+        for (auto x = 0; x < width; x++, destination += 4)
+        {
+            auto* source_pixel = source_row + static_cast<size_t>(x * video_frame.xres / width) * 4;
+            destination[0] = source_pixel[is_bgra ? 2 : 0];
+            destination[1] = source_pixel[1];
+            destination[2] = source_pixel[is_bgra ? 0 : 2];
+        }
+    }
+
+    NDIlib_framesync_free_video(framesync_instance, &video_frame);
+
+    std::lock_guard lock(m_mutex);
+    thumbnail.pixels = std::move(pixels);
+    thumbnail.has_new_pixels = true;
+    thumbnail.has_captured_since_opened = true;
+    thumbnail.last_capture_time = std::chrono::steady_clock::now();
+}
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include "NDI.h"
+#include "NDIReceiver.h"
+#include "NDIReceiverReaper.h"
+#include "NDISourceWindow.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <glad/gl.h>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Carousel
+{
+// A window showing a thumbnail of every source we've found, so they can be picked by what they show rather than by
+// name. Each source is received at the lowest bandwidth by a few workers of our own, and only grabbed about once a
+// second. Only so many receivers are open at once; with more sources than that, each gives up its receiver to another
+// source once it has a thumbnail, so they take turns.
+class SourceBrowser
+{
+public:
+    explicit SourceBrowser(NDIReceiverReaper&);
+    ~SourceBrowser();
+
+    SourceBrowser(const SourceBrowser&) = delete;
+
+    // Must be called every frame with whatever the finder has found, before draw().
+    void update(std::span<const NDIlib_source_t>);
+    // Returns the source that was clicked, if any. When is_open is set to false, we should be destroyed.
+    std::optional<NDISourceWindow::Source> draw(bool* is_open);
+
+private:
+    static constexpr int s_thumbnail_width = 256;
+    static constexpr int s_thumbnail_height = 144;
+    static constexpr float s_thumbnail_spacing = 8.0f;
+    static constexpr std::chrono::seconds s_refresh_interval{1};
+    static constexpr size_t s_number_of_workers = 2;
+    static constexpr size_t s_maximum_number_of_receivers = 16;
+
+    struct Thumbnail
+    {
+        NDISourceWindow::Source source;
+        // The rest is guarded by m_mutex, aside from the receiver whilst is_busy is set.
+        std::unique_ptr<NDIReceiver> receiver;
+        // Set whilst a worker is using this outside the lock.
+        bool is_busy{};
+        bool is_removed{};
+        bool has_captured_since_opened{};
+        std::chrono::steady_clock::time_point next_refresh_time;
+        std::chrono::steady_clock::time_point last_capture_time;
+        // Already letterboxed to s_thumbnail_width by s_thumbnail_height, waiting to be uploaded.
+        std::vector<uint8_t> pixels;
+        bool has_new_pixels{};
+        // Only used by the render thread. Zero until we have the first thumbnail.
+        GLuint texture{};
+
+        explicit Thumbnail(NDISourceWindow::Source source) : source(std::move(source)) {}
+    };
+
+    NDIReceiverReaper& m_receiver_reaper;
+    std::vector<std::shared_ptr<Thumbnail>> m_thumbnails;
+    // Textures of thumbnails that have gone away, for the next ones to reuse.
+    std::vector<GLuint> m_free_textures;
+    std::mutex m_mutex;
+    std::condition_variable_any m_condition;
+    size_t m_number_of_receivers{};
+    // Declared last, so that they are joined before anything they use goes away.
+    std::vector<std::jthread> m_workers;
+
+    GLuint take_texture();
+    void remove_thumbnail(const std::shared_ptr<Thumbnail>&);
+    void run(std::stop_token);
+    std::shared_ptr<Thumbnail> next_thumbnail_to_work_on(std::chrono::steady_clock::time_point now,
+                                                         std::chrono::steady_clock::time_point& next_wake_time);
+    void capture_thumbnail(Thumbnail&);
+};
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "SourceCapture.h"
+#include "Tracer.h"
+#include <JMP/ScopeGuard.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+namespace Carousel
+{
+SourceCapture::SourceCapture(const NDIlib_source_t& source)
+    : m_source_name(source.p_ndi_name ? source.p_ndi_name : ""),
+      m_source_url_address(source.p_url_address ? source.p_url_address : ""),
+      m_thread([this](std::stop_token stop_token) { run(stop_token); })
+{
+}
+
+SourceCapture::~SourceCapture()
+{
+    m_thread.request_stop();
+    m_thread.join();
+}
+
+std::unique_ptr<Recorder> SourceCapture::exchange_recorder(std::unique_ptr<Recorder> recorder)
+{
+    std::lock_guard lock(m_mutex);
+    std::swap(recorder, m_recorder);
+    return recorder;
+}
+
+std::unique_ptr<ReplayBuffer> SourceCapture::exchange_replay_buffer(std::unique_ptr<ReplayBuffer> replay_buffer)
+{
+    std::lock_guard lock(m_mutex);
+    std::swap(replay_buffer, m_replay_buffer);
+    return replay_buffer;
+}
+
+void SourceCapture::run(std::stop_token stop_token)
+{
+    Tracer::set_thread_name("Source capture");
+
+    NDIlib_source_t source(m_source_name.c_str(),
+                           m_source_url_address.empty() ? nullptr : m_source_url_address.c_str());
+
+    NDIlib_recv_create_v3_t receiver_create{};
+    // The most compact of whatever the source sends, with fields left as they are, so nothing is converted for us.
+    receiver_create.color_format = NDIlib_recv_color_format_UYVY_RGBA;
+    receiver_create.bandwidth = NDIlib_recv_bandwidth_highest;
+    receiver_create.allow_video_fields = true;
+    receiver_create.source_to_connect_to = source;
+
+    auto* receiver_instance = NDIlib_recv_create_v3(&receiver_create);
+    if (!receiver_instance)
+    {
+        fprintf(stderr, "Failed to create capture receiver for %s\n", m_source_name.c_str());
+        return;
+    }
+
+    JMP::ScopeGuard destroy_receiver = [receiver_instance]() { NDIlib_recv_destroy(receiver_instance); };
+
+    // NDI sends audio planar, and we record it interleaved. This grows to fit the biggest frame we've been sent.
+    std::vector<float> interleaved_samples;
+
+    while (!stop_token.stop_requested())
+    {
+        NDIlib_video_frame_v2_t video_frame{};
+        NDIlib_audio_frame_v2_t audio_frame{};
+
+        auto frame_type = NDIlib_recv_capture_v2(receiver_instance, &video_frame, &audio_frame, nullptr,
+                                                 s_capture_timeout_milliseconds);
+
+        if (frame_type == NDIlib_frame_type_video)
+        {
+            TraceScope trace_scope("Capture video");
+
+            auto received_at = std::chrono::steady_clock::now();
+
+            {
+                std::lock_guard lock(m_mutex);
+                if (m_recorder)
+                    m_recorder->record_video(video_frame);
+                if (m_replay_buffer)
+                    m_replay_buffer->push(video_frame, received_at);
+            }
+
+            NDIlib_recv_free_video_v2(receiver_instance, &video_frame);
+        }
+        else if (frame_type == NDIlib_frame_type_audio)
+        {
+            TraceScope trace_scope("Capture audio");
+
+            interleaved_samples.resize(std::max(interleaved_samples.size(),
+                                                static_cast<size_t>(audio_frame.no_samples) *
+                                                    static_cast<size_t>(audio_frame.no_channels)));
+
+            NDIlib_audio_frame_interleaved_32f_t audio_frame_interleaved_floats;
+            audio_frame_interleaved_floats.sample_rate = audio_frame.sample_rate;
+            audio_frame_interleaved_floats.no_channels = audio_frame.no_channels;
+            audio_frame_interleaved_floats.no_samples = audio_frame.no_samples;
+            audio_frame_interleaved_floats.p_data = interleaved_samples.data();
+            NDIlib_util_audio_to_interleaved_32f_v2(&audio_frame, &audio_frame_interleaved_floats);
+            audio_frame_interleaved_floats.timecode = audio_frame.timecode;
+
+            NDIlib_recv_free_audio_v2(receiver_instance, &audio_frame);
+
+            std::lock_guard lock(m_mutex);
+            if (m_recorder)
+                m_recorder->record_audio(audio_frame_interleaved_floats);
+        }
+    }
+}
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include "NDI.h"
+#include "Recorder.h"
+#include "ReplayBuffer.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Carousel
+{
+// Receives a source over a connection of its own, and takes every frame as it arrives on our own thread, so recording
+// and replay don't depend on how (or whether) the source is being shown. We always ask for the highest bandwidth, and
+// frames are as the source sent them, whatever its window happens to be receiving.
+class SourceCapture
+{
+public:
+    // Connecting is done on the capture thread, so this doesn't block.
+    explicit SourceCapture(const NDIlib_source_t&);
+    ~SourceCapture();
+
+    SourceCapture(const SourceCapture&) = delete;
+
+    // Swaps in what we record to (or nothing), handing back what was there before. The swap is all that happens whilst
+    // we hold our lock, so the capture thread is never kept waiting on a recorder being made.
+    std::unique_ptr<Recorder> exchange_recorder(std::unique_ptr<Recorder>);
+    // Only for the thread that exchanges recorders.
+    const Recorder* recorder() const { return m_recorder.get(); }
+
+    // Same again, for the replay buffer video is kept in.
+    std::unique_ptr<ReplayBuffer> exchange_replay_buffer(std::unique_ptr<ReplayBuffer>);
+    // Only for the thread that exchanges replay buffers, and it must hold lock() whilst reading the frames, as we're
+    // pushing to it.
+    ReplayBuffer* replay_buffer() const { return m_replay_buffer.get(); }
+
+    std::unique_lock<std::mutex> lock() { return std::unique_lock(m_mutex); }
+
+private:
+    static constexpr uint32_t s_capture_timeout_milliseconds = 100;
+
+    std::string m_source_name;
+    std::string m_source_url_address;
+    std::mutex m_mutex;
+    std::unique_ptr<Recorder> m_recorder;
+    std::unique_ptr<ReplayBuffer> m_replay_buffer;
+    // Declared last, so that it is joined before anything it uses goes away.
+    std::jthread m_thread;
+
+    void run(std::stop_token);
+};
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "Tracer.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Carousel
+{
+// About a minute of a busy main loop, at 24 bytes each.
+static constexpr uint64_t s_number_of_events_per_thread = 65536;
+// Enough for the main, audio and multiviewer threads, and a few windows capturing directly.
+static constexpr size_t s_number_of_spare_thread_buffers = 8;
+
+struct TraceEvent
+{
+    const char* name;
+    int64_t begin_nanoseconds;
+    int64_t end_nanoseconds;
+};
+
+struct ThreadTraceBuffer
+{
+    std::unique_ptr<TraceEvent[]> events = std::make_unique<TraceEvent[]>(s_number_of_events_per_thread);
+    // Every event ever recorded here, so the oldest we still have is this minus the size of the ring. Only the
+    // thread that owns the buffer writes to it.
+    std::atomic<uint64_t> number_of_events{};
+    std::atomic<const char*> thread_name{};
+    std::atomic<bool> is_in_use{};
+};
+
+// Buffers are never freed, so they can be written out after their thread is gone.
+static std::mutex s_thread_buffers_mutex;
+static std::vector<std::unique_ptr<ThreadTraceBuffer>> s_thread_buffers;
+
+// Hands the thread's buffer back when it exits, so that the next thread to trace can reuse it.
+struct ThreadTraceBufferLease
+{
+    ThreadTraceBuffer* buffer{};
+    const char* thread_name{};
+
+    ~ThreadTraceBufferLease()
+    {
+        if (buffer)
+            buffer->is_in_use.store(false, std::memory_order_release);
+    }
+};
+
+static thread_local ThreadTraceBufferLease s_thread_buffer_lease;
+
+// Returns null rather than waiting if someone else has the buffers, or allocating if none are spare.
+static ThreadTraceBuffer* try_acquire_thread_buffer()
+{
+    std::unique_lock lock(s_thread_buffers_mutex, std::try_to_lock);
+    if (!lock.owns_lock())
+        return nullptr;
+
+    auto iterator = std::find_if(s_thread_buffers.begin(), s_thread_buffers.end(), [](const auto& buffer) {
+        return !buffer->is_in_use.load(std::memory_order_acquire);
+    });
+
+    if (iterator == s_thread_buffers.end())
+        return nullptr;
+
+    // Whatever the last thread left here would otherwise show up under our name.
+    auto* buffer = iterator->get();
+    buffer->number_of_events.store(0, std::memory_order_relaxed);
+    buffer->thread_name.store(s_thread_buffer_lease.thread_name, std::memory_order_relaxed);
+    buffer->is_in_use.store(true, std::memory_order_relaxed);
+    return buffer;
+}
+
+void Tracer::set_enabled(bool is_enabled)
+{
+    if (is_enabled)
+    {
+        std::lock_guard lock(s_thread_buffers_mutex);
+
+        auto number_of_spare_buffers = static_cast<size_t>(
+            std::count_if(s_thread_buffers.begin(), s_thread_buffers.end(),
+                          [](const auto& buffer) { return !buffer->is_in_use.load(std::memory_order_acquire); }));
+
+        for (auto i = number_of_spare_buffers; i < s_number_of_spare_thread_buffers; i++)
+            s_thread_buffers.push_back(std::make_unique<ThreadTraceBuffer>());
+    }
+
+    s_is_enabled.store(is_enabled, std::memory_order_relaxed);
+}
+
+void Tracer::set_thread_name(const char* name)
+{
+    s_thread_buffer_lease.thread_name = name;
+    if (s_thread_buffer_lease.buffer)
+        s_thread_buffer_lease.buffer->thread_name.store(name, std::memory_order_relaxed);
+}
+
+void Tracer::record(const char* name, std::chrono::steady_clock::time_point begin,
+                    std::chrono::steady_clock::time_point end)
+{
+    if (!s_thread_buffer_lease.buffer && !(s_thread_buffer_lease.buffer = try_acquire_thread_buffer()))
+        return;
+
+    auto& buffer = *s_thread_buffer_lease.buffer;
+    auto index = buffer.number_of_events.load(std::memory_order_relaxed);
+    buffer.events[index % s_number_of_events_per_thread] = {
+        name, std::chrono::duration_cast<std::chrono::nanoseconds>(begin.time_since_epoch()).count(),
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end.time_since_epoch()).count()};
+    buffer.number_of_events.store(index + 1, std::memory_order_release);
+}
+
+bool Tracer::write(const std::filesystem::path& path)
+{
+    struct ThreadTrace
+    {
+        size_t thread_id;
+        const char* thread_name;
+        std::vector<TraceEvent> events;
+    };
+
+    // Threads wanting a buffer won't wait for us, so only hold on to them for as long as copying takes, and write the
+    // file out afterwards.
+    std::vector<ThreadTrace> thread_traces;
+
+    {
+        std::lock_guard lock(s_thread_buffers_mutex);
+        thread_traces.reserve(s_thread_buffers.size());
+
+        for (size_t i = 0; i < s_thread_buffers.size(); i++)
+        {
+            auto& buffer = *s_thread_buffers[i];
+            auto& thread_trace = thread_traces.emplace_back(
+                ThreadTrace{i + 1, buffer.thread_name.load(std::memory_order_relaxed), {}});
+
+            auto end_index = buffer.number_of_events.load(std::memory_order_acquire);
+            auto begin_index =
+                end_index > s_number_of_events_per_thread ? end_index - s_number_of_events_per_thread : 0;
+
+            thread_trace.events.reserve(end_index - begin_index);
+            for (auto index = begin_index; index < end_index; index++)
+                thread_trace.events.push_back(buffer.events[index % s_number_of_events_per_thread]);
+
+            // The thread kept recording whilst we copied, so anything it might have written over since is thrown away.
+            // That includes the slot it's in the middle of writing, which isn't counted yet.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            auto end_index_after_copying = buffer.number_of_events.load(std::memory_order_relaxed);
+            auto first_intact_index = end_index_after_copying + 1 > s_number_of_events_per_thread
+                                          ? end_index_after_copying + 1 - s_number_of_events_per_thread
+                                          : 0;
+
+            if (first_intact_index > begin_index)
+            {
+                auto number_of_overwritten_events = std::min(first_intact_index - begin_index, end_index - begin_index);
+                thread_trace.events.erase(thread_trace.events.begin(),
+                                          thread_trace.events.begin() +
+                                              static_cast<ptrdiff_t>(number_of_overwritten_events));
+            }
+        }
+    }
+
+    auto* file = fopen(path.c_str(), "w");
+    if (!file)
+        return false;
+
+    auto is_first_event = true;
+
+    auto write_separator = [&]() {
+        fprintf(file, is_first_event ? "\n" : ",\n");
+        is_first_event = false;
+    };
+
+    fprintf(file, "{\"traceEvents\":[");
+
+    for (auto& thread_trace : thread_traces)
+    {
+        if (thread_trace.thread_name)
+        {
+            write_separator();
+            fprintf(file, R"({"name":"thread_name","ph":"M","pid":1,"tid":%zu,"args":{"name":"%s"}})",
+                    thread_trace.thread_id, thread_trace.thread_name);
+        }
+
+        for (auto& event : thread_trace.events)
+        {
+            write_separator();
+            fprintf(file, R"({"name":"%s","ph":"X","pid":1,"tid":%zu,"ts":%.3f,"dur":%.3f})", event.name,
+                    thread_trace.thread_id, static_cast<double>(event.begin_nanoseconds) / 1000.0,
+                    static_cast<double>(event.end_nanoseconds - event.begin_nanoseconds) / 1000.0);
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    return fclose(file) == 0;
+}
+}
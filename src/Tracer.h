@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+
+namespace Carousel
+{
+// Collects how long things take on each thread, for finding out where a stutter came from after the fact. Each thread
+// records into a ring of its own without taking any locks, so the most recent events are always there to be written
+// out (as Chrome trace JSON, which Perfetto also opens). Whilst disabled, tracing costs a relaxed load per TraceScope.
+//
+// Recording never allocates or waits, as the audio callback traces too. Buffers are made ahead of time when tracing is
+// enabled, and a thread that finds none spare (or finds someone else handing them out) drops its events instead.
+class Tracer
+{
+public:
+    static bool is_enabled() { return s_is_enabled.load(std::memory_order_relaxed); }
+    static void set_enabled(bool);
+
+    // Names the calling thread in the trace. Only the pointer is kept, so this should be a string literal.
+    static void set_thread_name(const char*);
+    // Like the thread name, the event's name must be a string literal.
+    static void record(const char* name, std::chrono::steady_clock::time_point begin,
+                       std::chrono::steady_clock::time_point end);
+    // Writes out every event we still have, from every thread. Returns false if the file couldn't be written.
+    static bool write(const std::filesystem::path&);
+
+private:
+    static inline std::atomic<bool> s_is_enabled{};
+};
+
+// Records an event for as long as this is alive, if tracing was enabled when it was created.
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name) : m_name(name)
+    {
+        if (Tracer::is_enabled())
+            m_begin = std::chrono::steady_clock::now();
+    }
+
+    ~TraceScope()
+    {
+        if (m_begin != std::chrono::steady_clock::time_point{})
+            Tracer::record(m_name, m_begin, std::chrono::steady_clock::now());
+    }
+
+    TraceScope(const TraceScope&) = delete;
+
+private:
+    const char* m_name;
+    std::chrono::steady_clock::time_point m_begin{};
+};
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "UYVYConverter.h"
+#include <string_view>
+
+namespace Carousel
+{
+static constexpr std::string_view s_vertex_shader_source = R"(#version 330 core
+void main()
+{
+    // One triangle that covers the whole framebuffer.
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+static constexpr std::string_view s_fragment_shader_source = R"(#version 330 core
+uniform sampler2D uyvy_frame;
+uniform bool is_standard_definition;
+
+out vec4 color;
+
+void main()
+{
+    ivec2 position = ivec2(gl_FragCoord.xy);
+    vec4 pair = texelFetch(uyvy_frame, ivec2(position.x >> 1, position.y), 0);
+
+    // Both pixels of a pair share their chroma. NDI sends limited range, so stretch it back out to full range.
+    float y = (((position.x & 1) == 0 ? pair.g : pair.a) - 16.0 / 255.0) * (255.0 / 219.0);
+    float u = (pair.r - 128.0 / 255.0) * (255.0 / 224.0);
+    float v = (pair.b - 128.0 / 255.0) * (255.0 / 224.0);
+
+    // Like everyone else, NDI uses BT.601 for SD and BT.709 for everything bigger.
+    if (is_standard_definition)
+        color = vec4(y + 1.402 * v, y - 0.344136 * u - 0.714136 * v, y + 1.772 * u, 1.0);
+    else
+        color = vec4(y + 1.5748 * v, y - 0.187324 * u - 0.468124 * v, y + 1.8556 * u, 1.0);
+}
+)";
+
+UYVYConverter::UYVYConverter() : m_program(s_vertex_shader_source, s_fragment_shader_source)
+{
+    m_is_standard_definition_uniform_location = m_program.uniform_location("is_standard_definition");
+
+    glUseProgram(m_program.name());
+    glUniform1i(m_program.uniform_location("uyvy_frame"), 0);
+    glUseProgram(0);
+
+    glGenVertexArrays(1, &m_vertex_array);
+    glGenFramebuffers(1, &m_framebuffer);
+
+    glGenTextures(1, &m_uyvy_texture);
+    glBindTexture(GL_TEXTURE_2D, m_uyvy_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+UYVYConverter::~UYVYConverter()
+{
+    glDeleteTextures(1, &m_uyvy_texture);
+    glDeleteFramebuffers(1, &m_framebuffer);
+    glDeleteVertexArrays(1, &m_vertex_array);
+}
+
+void UYVYConverter::convert(GLuint output, int width, int height, int line_stride_in_bytes, const void* data)
+{
+    if (width <= 0 || height <= 0)
+        return;
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_uyvy_texture);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, line_stride_in_bytes / 4);
+    // An odd width still sends its last pixel, in a pair of its own.
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, (width + 1) / 2, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    auto was_blend_enabled = glIsEnabled(GL_BLEND);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, output, 0);
+    glViewport(0, 0, width, height);
+
+    glDisable(GL_BLEND);
+    glUseProgram(m_program.name());
+    glUniform1i(m_is_standard_definition_uniform_location, height < 720);
+
+    glBindVertexArray(m_vertex_array);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    if (was_blend_enabled)
+        glEnable(GL_BLEND);
+}
+}
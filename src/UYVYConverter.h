@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2023, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include "ShaderProgram.h"
+#include <glad/gl.h>
+
+namespace Carousel
+{
+// Converts UYVY (4:2:2, two pixels to every four bytes) frames to RGBA on the GPU. Asking NDI for UYVY instead of RGBA
+// halves what we copy and upload, and skips the conversion NDI would otherwise do on the CPU.
+class UYVYConverter
+{
+public:
+    UYVYConverter();
+    ~UYVYConverter();
+
+    UYVYConverter(const UYVYConverter&) = delete;
+
+    // Renders the frame into output, which must already be an RGBA texture of the same size.
+    void convert(GLuint output, int width, int height, int line_stride_in_bytes, const void* data);
+
+private:
+    ShaderProgram m_program;
+    GLuint m_vertex_array{};
+    GLuint m_framebuffer{};
+    // Each texel is one pair of pixels: U, Y0, V, Y1.
+    GLuint m_uyvy_texture{};
+    GLint m_is_standard_definition_uniform_location{};
+};
+}
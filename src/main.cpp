@@ -5,15 +5,49 @@
  */
 
 #include "Application.h"
+#include "HeadlessMonitor.h"
 #include "NDI.h"
 #include <GLFW/glfw3.h>
 #define MINIAUDIO_IMPLEMENTATION
 #include <miniaudio.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-int main()
+static int run_headless(const char* configuration_path)
 {
+    if (!NDIlib_initialize())
+    {
+        fprintf(stderr, "Failed to initialize NDI\n");
+        return EXIT_FAILURE;
+    }
+
+    atexit(NDIlib_destroy);
+
+    try
+    {
+        Carousel::HeadlessMonitor headless_monitor(configuration_path);
+        return headless_monitor.run();
+    }
+    catch (const std::exception& ex)
+    {
+        fprintf(stderr, "Error occurred during initialization/execution: %s\n", ex.what());
+        return EXIT_FAILURE;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    // Without a display there's no GLFW to initialize, so this has to be decided before we do anything else.
+    if (argc == 3 && strcmp(argv[1], "--headless") == 0)
+        return run_headless(argv[2]);
+
+    if (argc != 1)
+    {
+        fprintf(stderr, "Usage: %s [--headless CONFIGURATION]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
     if (!glfwInit())
     {
         const char* error;